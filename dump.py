@@ -1,52 +1,576 @@
 import argparse
+import os
 import serial
+import signal
+import struct
+import time
+
+import gbcodec
+import gbstub
 
 DEFAULT_BAUDRATE = 57600
+# Must match software/src/protocol.h
+DELTA_BLOCK_SIZE = 256
+DELTA_READ = 0x80
+DELTA_END = 0xFF
+SEARCH_PATTERNS_MAX = 8
+SEARCH_PATTERN_MAX = 16
+SEARCH_MATCHES_MAX = 64
 
 # Define the parameters for the program
 parser = argparse.ArgumentParser(
                 prog='dump.py',
                 description='Read and dump cartridge saves from Zeal 8-bit Computer to a file'
             )
-parser.add_argument('-o', dest='outfile', help='Output save file name', required=True)
+parser.add_argument('-o', dest='outfile', help='Output save file name', required=False)
+parser.add_argument('-i', dest='infile', help='Save file to restore to the cartridge, instead of dumping it', required=False)
+parser.add_argument('-z', '--compress', dest='compress', help='Compress the save restored with -i, the 8-bit computer decompresses it', required=False, action='store_true')
+parser.add_argument('--delta', dest='delta', help='Only write the blocks of the save restored with -i that differ from the cartridge', required=False, action='store_true')
+parser.add_argument('--sync', dest='sync', help='Synchronise the save both ways with an emulator save, or with the newest .sav of a directory', metavar='PATH', required=False)
+parser.add_argument('--prefer', dest='prefer', choices=['cart', 'emu'], help='Side that wins the blocks changed on both sides since the last --sync, they are only reported otherwise', required=False)
 parser.add_argument('-d', dest='ttynode', help='UART device node, e.g. /dev/ttyUSB0', required=True)
 parser.add_argument('-v', '--verbose', dest='verbose', help='Enable verbose mode', required=False, action='store_true')
 parser.add_argument('-b', dest='baudrate', type=int, help='Baudrate to use with the serial node', default=DEFAULT_BAUDRATE, required=False)
+parser.add_argument('-r', '--rom', dest='rom', help='Dump the cartridge ROM instead of the save (MBC1 and MBC5)', required=False, action='store_true')
+parser.add_argument('--scan', dest='scan', type=int, nargs='?', const=50, help='Read a sample of the ROM and the SRAM PASSES times (50 by default) and report the unstable blocks, to check the contacts before a dump', metavar='PASSES', required=False)
+parser.add_argument('--test', dest='test', help='Test the cartridge SRAM, its content is kept', required=False, action='store_true')
+parser.add_argument('--search', dest='search', nargs='+', help='Search the SRAM (the ROM with -r) for hexadecimal patterns, ? matches any nibble, e.g. 50??C3', metavar='PATTERN', required=False)
+parser.add_argument('--watch', dest='watch', help='Watch the SRAM and print its changes until Ctrl-C, the last content is saved to -o if given', required=False, action='store_true')
+parser.add_argument('--camera', dest='camera', help='Game Boy Camera: only receive the photos and save them as PNG files in the -o directory', required=False, action='store_true')
+parser.add_argument('-w', dest='stall', type=float, help='Abort if the 8-bit computer is silent for this many seconds', required=False)
+parser.add_argument('-t', '--trace', dest='trace', help='Receive the event trace of the dump and print it as a timeline', required=False, action='store_true')
+parser.add_argument('-s', dest='stubs', help='Directory of stubs (.stub, see gbstub.py), the best one for the cartridge is uploaded', required=False)
 args = parser.parse_args()
+if not args.test and args.scan is None and args.search is None and not args.watch and args.sync is None and (args.outfile is None) == (args.infile is None):
+    parser.error("exactly one of -o and -i must be given")
 
 if args.verbose:
     print("Connecting to " + args.ttynode + " with baudrate " + str(args.baudrate))
 
 
+# Events of the trace sent by the 8-bit computer, see software/src/trace.h
+TRACE_EVENT_SIZE = 6
+
+def describe_event(kind, arg8, arg16):
+    if kind == 1:
+        return "map 0x%06x" % ((arg8 << 16) | arg16)
+    if kind == 2:
+        return "select SRAM bank %d" % arg8
+    if kind == 3:
+        return "UART write %d bytes" % arg16 + (", error %d" % arg8 if arg8 else "")
+    if kind == 4:
+        return "error %d" % arg8
+    if kind == 5:
+        return "command '%c'" % arg8
+    return "unknown event %d" % kind
+
+def print_trace(ser):
+    header = ser.read(2)
+    if len(header) != 2 or header[0] != ord('~'):
+        print("No trace received from the 8-bit computer")
+        return
+    data = ser.read(header[1] * TRACE_EVENT_SIZE)
+    print("Trace of the last %d events:" % (len(data) // TRACE_EVENT_SIZE))
+    elapsed = 0
+    previous = None
+    for offset in range(0, len(data) - TRACE_EVENT_SIZE + 1, TRACE_EVENT_SIZE):
+        kind, arg8, time, arg16 = struct.unpack_from("<BBHH", data, offset)
+        # The timestamps are 16-bit milliseconds, they wrap around after about one minute
+        if previous is None:
+            previous = time
+        delta = (time - previous) & 0xffff
+        elapsed += delta
+        previous = time
+        print("  %8d ms  +%5d ms  %s" % (elapsed, delta, describe_event(kind, arg8, arg16)))
+
+
 # Let's have a timeout of around one second
 ser = serial.Serial(args.ttynode, args.baudrate, timeout=args.baudrate)
+# Long operations on the 8-bit computer send heartbeats, so the stall timeout can be short
+if args.stall is not None:
+    ser.timeout = args.stall
 
-# Create the destination file
-outfile = open(args.outfile, "wb")
+def read_reply(size):
+    """Read a reply of `size` bytes, skipping the heartbeat frames that may precede it"""
+    while True:
+        first = ser.read(1)
+        if len(first) == 0:
+            print("The 8-bit computer stopped responding")
+            exit(1)
+        if first[0] != ord('H'):
+            return first + ser.read(size - 1)
+        progress = ser.read(2)
+        if args.verbose and len(progress) == 2:
+            print("Working... %d" % (progress[0] | (progress[1] << 8)))
 
-# We are ready, send '!' to the 8-bit computer
-ser.write(b'!')
 
-# Wait for the message containing:
-# '=' character
-# Number of banks to dump, in binary (8-bit)
-# Size of each bank, in binary (16-bit little-endian)
-bytes = ser.read(4)
+# With a stub library, switch to the resident mode to learn the cartridge type and upload the stub
+stub = None
+if args.stubs:
+    ser.write(b'R')
+    bytes = read_reply(2)
+    if len(bytes) != 2 or bytes[0] != ord('K'):
+        print("The 8-bit computer doesn't support the resident mode")
+        exit(1)
+    stub = gbstub.pick(gbstub.load_library(args.stubs), bytes[1])
+    if stub is not None:
+        if args.verbose:
+            print("Uploading stub " + stub.name + " for cartridge type " + hex(bytes[1]))
+        ser.write(b'U' + stub.blob)
+        bytes = read_reply(2)
+        if len(bytes) != 2 or bytes[0] != ord('K'):
+            print("The stub " + stub.name + " was rejected")
+            ser.write(b'Q')
+            exit(1)
 
-if bytes[0] != ord('='):
-    print("Invalid message header from the 8-bit computer: ", hex(bytes[0]))
-    exit(1)
+if args.trace:
+    ser.write(b'T')
+    bytes = read_reply(2)
+    if len(bytes) != 2 or bytes[0] != ord('K'):
+        print("The 8-bit computer doesn't support the event trace")
+        args.trace = False
+
+def read_info():
+    """Read the REPLY_INFO message: number of banks (8-bit), size of each bank (16-bit). The ROM dump
+    replies with REPLY_INFO16 ('+') instead, its number of banks is 16-bit."""
+    bytes = read_reply(2)
+    if bytes[0] == ord('E'):
+        print("The 8-bit computer doesn't support this operation on the cartridge")
+        exit(1)
+    if bytes[0] == ord('+'):
+        bytes += ser.read(3)
+        return bytes[1] | (bytes[2] << 8), bytes[3] | (bytes[4] << 8)
+    bytes += ser.read(2)
+    if bytes[0] != ord('='):
+        print("Invalid message header from the 8-bit computer: ", hex(bytes[0]))
+        exit(1)
+    return bytes[1], bytes[2] | (bytes[3] << 8)
+
+if args.sync:
+    path = args.sync
+    if os.path.isdir(path):
+        saves = [os.path.join(path, name) for name in os.listdir(path) if name.lower().endswith('.sav')]
+        if not saves:
+            print("No .sav file in " + path)
+            exit(1)
+        path = max(saves, key=os.path.getmtime)
+    with open(path, "rb") as infile:
+        emu = infile.read()
+    # Content of the save after the last sync, the common ancestor of both sides
+    base_path = path + ".base"
+    base = None
+    if os.path.exists(base_path):
+        with open(base_path, "rb") as infile:
+            base = infile.read()
+    print("Synchronising the cartridge with " + path)
+    ser.write(b'D')
+    bank_num, bank_size = read_info()
+    total = bank_num * bank_size
+    # Emulators may append data to the save, such as the MBC3 RTC, it is kept as is
+    trailer = emu[total:]
+    emu = bytearray(emu[:total].ljust(total, b'\xff'))
+    if base is not None and len(base) != total:
+        base = None
+    blocks = total // DELTA_BLOCK_SIZE
+    hashes = struct.unpack("<%dI" % blocks, ser.read(blocks * 4))
+    pull, push, conflicts = [], [], []
+    for i in range(blocks):
+        area = slice(i * DELTA_BLOCK_SIZE, (i + 1) * DELTA_BLOCK_SIZE)
+        mine = gbcodec.block_hash(emu[area])
+        if hashes[i] == mine:
+            continue
+        ancestor = gbcodec.block_hash(base[area]) if base is not None else None
+        if ancestor == mine or (ancestor != hashes[i] and args.prefer == 'cart'):
+            pull.append(i)
+        elif ancestor == hashes[i] or args.prefer == 'emu':
+            push.append(i)
+        else:
+            conflicts.append(i)
+    print("%d blocks to pull from the cartridge, %d to push to it, %d in conflict" %
+          (len(pull), len(push), len(conflicts)))
+    per_bank = bank_size // DELTA_BLOCK_SIZE
+    for i in pull + push + [None]:
+        bytes = read_reply(2)
+        if bytes[0] != ord('>'):
+            break
+        if i is None:
+            ser.write(struct.pack("B", DELTA_END) + b'\0' * 5)
+            bytes = read_reply(2)
+            break
+        area = slice(i * DELTA_BLOCK_SIZE, (i + 1) * DELTA_BLOCK_SIZE)
+        if i in pull:
+            ser.write(struct.pack("<BBI", DELTA_READ | (i // per_bank), i % per_bank, 0))
+            header = ser.read(3)
+            if len(header) != 3 or header[0] != ord('#'):
+                print("Invalid block from the 8-bit computer")
+                exit(1)
+            emu[area] = ser.read(DELTA_BLOCK_SIZE)
+        else:
+            ser.write(struct.pack("<BBI", i // per_bank, i % per_bank, gbcodec.block_hash(emu[area])) + emu[area])
+    if args.trace:
+        print_trace(ser)
+    if args.stubs:
+        ser.write(b'Q')
+    if bytes[0] != ord('K'):
+        print("Sync failed with error %d, %s was not modified" % (bytes[1], path))
+        exit(1)
+    if pull:
+        with open(path, "wb") as outfile:
+            outfile.write(emu + trailer)
+    # Both sides now hold the same content, except the conflicts whose ancestor is kept. Without
+    # an ancestor, all the differences are conflicts, there is nothing to record until they are solved.
+    if base is not None or not conflicts:
+        merged = bytearray(emu)
+        for i in conflicts:
+            area = slice(i * DELTA_BLOCK_SIZE, (i + 1) * DELTA_BLOCK_SIZE)
+            merged[area] = base[area]
+        with open(base_path, "wb") as outfile:
+            outfile.write(merged)
+    for i in conflicts:
+        print("Conflict: bank %d, 0x%04x-0x%04x changed on both sides, use --prefer to choose one" %
+              (i // per_bank, 0xA000 + (i % per_bank) * DELTA_BLOCK_SIZE,
+               0xA000 + (i % per_bank + 1) * DELTA_BLOCK_SIZE - 1))
+    print("Sync done" if not conflicts else "Sync done, %d blocks in conflict were left untouched" % len(conflicts))
+    exit(1 if conflicts else 0)
+
+if args.infile:
+    with open(args.infile, "rb") as infile:
+        data = infile.read()
+    ser.write(b'D' if args.delta else b'Z' if args.compress else b'W')
+    bank_num, bank_size = read_info()
+    total = bank_num * bank_size
+    if len(data) < total:
+        # The 8-bit computer waits for the whole save, complete it with the erased value
+        print("Warning: %s is smaller than the cartridge save (%d bytes)" % (args.infile, total))
+        data += b'\xff' * (total - len(data))
+    print("Restoring %d banks of %d bytes, %d bytes in total..." % (bank_num, bank_size, total))
+    if args.delta:
+        blocks = total // DELTA_BLOCK_SIZE
+        hashes = struct.unpack("<%dI" % blocks, ser.read(blocks * 4))
+        changed = [i for i in range(blocks)
+                   if gbcodec.block_hash(data[i * DELTA_BLOCK_SIZE:(i + 1) * DELTA_BLOCK_SIZE]) != hashes[i]]
+        print("%d of %d blocks differ" % (len(changed), blocks))
+        per_bank = bank_size // DELTA_BLOCK_SIZE
+        for i in changed + [None]:
+            bytes = read_reply(2)
+            if bytes[0] != ord('>'):
+                break
+            if i is None:
+                ser.write(struct.pack("B", DELTA_END) + b'\0' * 5)
+                bytes = read_reply(2)
+            else:
+                block = data[i * DELTA_BLOCK_SIZE:(i + 1) * DELTA_BLOCK_SIZE]
+                ser.write(struct.pack("<BBI", i // per_bank, i % per_bank, gbcodec.block_hash(block)) + block)
+    elif not args.compress:
+        # Each bank is sent once the 8-bit computer is ready to receive it
+        for bank in range(bank_num):
+            bytes = read_reply(2)
+            if bytes[0] != ord('>'):
+                break
+            ser.write(data[bank * bank_size:(bank + 1) * bank_size])
+        else:
+            bytes = read_reply(2)
+    else:
+        sent = 0
+        for bank in range(bank_num):
+            content = data[bank * bank_size:(bank + 1) * bank_size]
+            frames = gbcodec.pack_frames(content)
+            # The last frame gives the hash the 8-bit computer checks the bank against
+            frames.append((gbcodec.PACK_END, b'', 0))
+            for kind, payload, decoded in frames:
+                bytes = read_reply(2)
+                if bytes[0] != ord('>'):
+                    break
+                if kind == gbcodec.PACK_END:
+                    ser.write(struct.pack("<BI", kind, gbcodec.block_hash(content)))
+                else:
+                    ser.write(struct.pack("<BHH", kind, len(payload), decoded) + payload)
+                    sent += len(payload)
+            if bytes[0] != ord('>'):
+                break
+        else:
+            bytes = read_reply(2)
+        if args.verbose:
+            print("%d bytes sent, %.1f%% of the save" % (sent, 100.0 * sent / total))
+    if args.trace:
+        print_trace(ser)
+    if args.stubs:
+        ser.write(b'Q')
+    if bytes[0] != ord('K'):
+        print("Restore failed with error %d" % bytes[1])
+        exit(1)
+    print(args.infile + " successfully restored")
+    exit(0)
+
+if args.scan is not None:
+    passes = max(2, min(args.scan, 255))
+    print("Scanning the read stability, %d passes..." % passes)
+    ser.write(b'V' + struct.pack("B", passes))
+    reply = read_reply(2)
+    unstable = 0
+    for _ in range(reply[1]):
+        # Each block: ROM (0) or SRAM (1), SRAM bank, address or offset (16-bit), unstable passes
+        kind, bank, offset, count = struct.unpack("<BBHB", ser.read(5))
+        name = "ROM  0x%04x" % offset if kind == 0 else "SRAM bank %d offset 0x%04x" % (bank, offset)
+        if count:
+            unstable += 1
+        if count or args.verbose:
+            print("  %-28s %3d/%d unstable reads (%.0f%%)" % (name, count, passes - 1, 100.0 * count / (passes - 1)))
+    if args.trace:
+        print_trace(ser)
+    if args.stubs:
+        ser.write(b'Q')
+    if unstable:
+        print("%d of %d blocks are unstable, clean or reseat the cartridge before dumping it" % (unstable, reply[1]))
+        exit(1)
+    print("All the %d blocks read the same in every pass" % reply[1])
+    exit(0)
+
+if args.test:
+    print("Testing the SRAM...")
+    ser.write(b'X')
+    bytes = read_reply(2)
+    if bytes[0] != ord('K'):
+        print("The cartridge has no SRAM to test")
+        exit(1)
+    failed = 0
+    for bank in range(bytes[1]):
+        # Result of each bank: errors, offset of the first one (16-bit), bits stuck at 0 and at 1
+        errors, first, stuck0, stuck1 = struct.unpack("<HHBB", ser.read(6))
+        if errors:
+            failed += 1
+            print("Bank %d: %d errors, first at offset 0x%04x, bits stuck at 0: 0x%02x, at 1: 0x%02x" %
+                  (bank, errors, first, stuck0, stuck1))
+        elif args.verbose:
+            print("Bank %d: OK" % bank)
+    if args.trace:
+        print_trace(ser)
+    if args.stubs:
+        ser.write(b'Q')
+    if failed:
+        print("%d of %d banks failed the test" % (failed, bytes[1]))
+        exit(1)
+    print("SRAM test passed, %d banks" % bytes[1])
+    exit(0)
+
+if args.watch:
+    ser.write(b'L')
+    bank_num, bank_size = read_info()
+    image = bytearray(bank_num * bank_size)
+    received = 0
+    print("Watching %d banks of %d bytes, Ctrl-C to stop..." % (bank_num, bank_size))
+    # Ctrl-C stops the watch. The abort is sent once, the 8-bit computer checks for it between two
+    # passes: any other byte would be taken as a command once the watch is over.
+    stopping = False
+    def on_stop(signum, frame):
+        global stopping
+        stopping = True
+    signal.signal(signal.SIGINT, on_stop)
+    stall = ser.timeout
+    ser.timeout = 0.5
+    last = time.monotonic()
+    abort_sent = False
+    while True:
+        if stopping and not abort_sent:
+            ser.write(b'A')
+            abort_sent = True
+        frame = ser.read(1)
+        if not frame:
+            if time.monotonic() - last > stall:
+                print("The 8-bit computer stopped responding")
+                exit(1)
+            continue
+        last = time.monotonic()
+        if frame[0] == ord('H'):
+            ser.read(2)
+            continue
+        if frame[0] != ord('#'):
+            ser.read(1)
+            break
+        # Changed block: bank, block in the bank, then its content
+        bank, block = ser.read(2)
+        content = ser.read(DELTA_BLOCK_SIZE)
+        start = bank * bank_size + block * DELTA_BLOCK_SIZE
+        if received < len(image) // DELTA_BLOCK_SIZE:
+            # First pass, all the blocks are sent
+            received += 1
+            if received == len(image) // DELTA_BLOCK_SIZE:
+                print("Initial content received")
+        else:
+            changed = [i for i in range(DELTA_BLOCK_SIZE) if content[i] != image[start + i]]
+            if changed:
+                first, end = changed[0], changed[-1] + 1
+                print("%s bank %d 0x%04x: %s -> %s" % (time.strftime("%H:%M:%S"), bank,
+                      0xA000 + block * DELTA_BLOCK_SIZE + first,
+                      image[start + first:start + end].hex(), content[first:end].hex()))
+        image[start:start + DELTA_BLOCK_SIZE] = content
+    signal.signal(signal.SIGINT, signal.SIG_DFL)
+    ser.timeout = stall
+    if args.trace:
+        print_trace(ser)
+    if args.stubs:
+        ser.write(b'Q')
+    if args.outfile:
+        with open(args.outfile, "wb") as outfile:
+            outfile.write(image)
+        print(args.outfile + " written with the last content")
+    exit(0)
 
-bank_num  = bytes[1]
-bank_size = (bytes[2]) | (bytes[3] << 8)
+if args.search:
+    patterns = []
+    for text in args.search:
+        text = text.replace(' ', '')
+        if len(text) % 2 or not 0 < len(text) // 2 <= SEARCH_PATTERN_MAX or \
+                any(c not in '0123456789abcdefABCDEF?' for c in text):
+            print("Invalid pattern %s, up to %d hexadecimal bytes are expected" % (text, SEARCH_PATTERN_MAX))
+            exit(1)
+        # Each ? nibble is cleared in the mask
+        value = int(text.replace('?', '0'), 16).to_bytes(len(text) // 2, 'big')
+        mask = int(''.join('0' if c == '?' else 'F' for c in text), 16).to_bytes(len(text) // 2, 'big')
+        patterns.append((text, value, mask))
+    if len(patterns) > SEARCH_PATTERNS_MAX:
+        print("Too many patterns, %d at most" % SEARCH_PATTERNS_MAX)
+        exit(1)
+    print("Searching the %s..." % ("ROM" if args.rom else "SRAM"))
+    ser.write(b'S' + struct.pack("BB", 0 if args.rom else 1, len(patterns)))
+    for _, value, mask in patterns:
+        # Fixed-size records, the bytes and the masks are padded
+        ser.write(struct.pack("B", len(value)) + value.ljust(SEARCH_PATTERN_MAX, b'\0') +
+                  mask.ljust(SEARCH_PATTERN_MAX, b'\0'))
+    bytes = read_reply(2)
+    if bytes[0] != ord('K'):
+        print("The %s of this cartridge can't be searched" % ("ROM" if args.rom else "SRAM"))
+        exit(1)
+    # Each match: index of the pattern, bank (16-bit) and offset in the bank (16-bit)
+    matches = sorted(struct.unpack("<BHH", ser.read(5)) for _ in range(bytes[1]))
+    for index, bank, offset in matches:
+        # Address as seen by the Game Boy, the bank 0 of the ROM is the fixed one
+        addr = (0x4000 if bank else 0) + offset if args.rom else 0xA000 + offset
+        print("%s: bank %d, offset 0x%04x (0x%04x)" % (patterns[index][0], bank, offset, addr))
+    if args.trace:
+        print_trace(ser)
+    if args.stubs:
+        ser.write(b'Q')
+    if len(matches) == SEARCH_MATCHES_MAX:
+        print("Only the first %d matches are reported" % SEARCH_MATCHES_MAX)
+    elif not matches:
+        print("No match")
+    exit(0)
+
+if args.camera:
+    # Imported here, numpy is only required for the camera
+    import gbcamera
+    ser.write(b'M')
+    # Other cartridges only reply 'E' and 0, the rest of the slot state vector follows 'K'
+    state = read_reply(2)
+    if state[0] != ord('K'):
+        print("The cartridge is not a Game Boy Camera")
+        exit(1)
+    state += ser.read(29)
+    slots = [slot for slot in range(30) if state[1 + slot] != 0xff]
+    print("Receiving %d photos..." % len(slots))
+    os.makedirs(args.outfile, exist_ok=True)
+    for slot in slots:
+        photo = ser.read(gbcamera.PHOTO_SIZE)
+        if len(photo) != gbcamera.PHOTO_SIZE:
+            print("The 8-bit computer stopped responding")
+            exit(1)
+        # Name the photos after their index in the album
+        name = os.path.join(args.outfile, "photo%02d.png" % (state[1 + slot] + 1))
+        gbcamera.write_png(name, gbcamera.decode_photo(photo))
+        if args.verbose:
+            print(name + " saved")
+    if args.trace:
+        print_trace(ser)
+    if args.stubs:
+        ser.write(b'Q')
+    print("%d photos saved in %s" % (len(slots), args.outfile))
+    exit(0)
+
+# We are ready, send '!' to the 8-bit computer, 'O' for the ROM
+if args.rom:
+    # The stubs only process the SRAM banks
+    stub = None
+    ser.write(b'O')
+else:
+    ser.write(b'!')
+
+# Wait for the message containing:
+# '=' character, '+' for the ROM
+# Number of banks to dump, in binary (8-bit, 16-bit after '+' for the ROM)
+# Size of each bank, in binary (16-bit little-endian)
+bank_num, bank_size = read_info()
 total = bank_num * bank_size
 
 print("Dumping %d banks of %d bytes, %d bytes in total..." % (bank_num, bank_size, total))
 
-# Receive all the data from the other end
-bytes = ser.read(total)
+# Ctrl-C pauses the dump. The 8-bit computer checks for it between two banks, so the pause takes
+# effect after the current bank or after the next one, when nothing follows it.
+interrupted = False
+pause_sent = False
+pending = b''
+
+def on_interrupt(signum, frame):
+    global interrupted
+    interrupted = True
+
+def receive(size):
+    global pending, pause_sent
+    data, pending = pending[:size], pending[size:]
+    while len(data) < size:
+        chunk = ser.read(min(size - len(data), 256))
+        if not chunk:
+            print("The 8-bit computer stopped responding")
+            exit(1)
+        data += chunk
+        if interrupted and not pause_sent:
+            ser.write(b'P')
+            pause_sent = True
+    return data
+
+def paused():
+    global pending
+    timeout = ser.timeout
+    ser.timeout = 0.5
+    pending = ser.read(1)
+    ser.timeout = timeout
+    return not pending
+
+signal.signal(signal.SIGINT, on_interrupt)
+bytes = b''
+aborted = False
+for bank in range(bank_num):
+    if stub is None:
+        bytes += receive(bank_size)
+    else:
+        # Each bank processed by the stub is preceded by its size (16-bit little-endian)
+        header = receive(2)
+        bytes += stub.decode(receive(header[0] | (header[1] << 8)), bank_size)
+    if pause_sent and bank + 1 < bank_num and paused():
+        answer = input("\nDump paused after %d banks, [r]esume or [a]bort? " % (bank + 1))
+        interrupted = pause_sent = False
+        if answer.lower().startswith('r'):
+            ser.write(b'C')
+        else:
+            ser.write(b'A')
+            aborted = True
+            break
+signal.signal(signal.SIGINT, signal.SIG_DFL)
+
+if args.trace:
+    print_trace(ser)
+
+if aborted:
+    if args.stubs:
+        ser.write(b'Q')
+    print("Dump aborted, " + args.outfile + " was not written")
+    exit(1)
+
+if args.stubs:
+    ser.write(b'Q')
 
 # Store the bytes in the file
+outfile = open(args.outfile, "wb")
 outfile.write(bytes)
 
 # Success, end the program
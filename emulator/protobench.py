@@ -0,0 +1,173 @@
+import argparse
+import os
+import random
+import re
+import resource
+import subprocess
+import sys
+import tempfile
+import time
+
+# Protocol throughput benchmark: run complete sessions, dump.py against gbdump.bin running in
+# zealemu, for each baudrate and each payload of a corpus, and print the goodput and the CPU time
+# on both sides. The saves are dumped, restored and restored compressed, the ROMs are dumped. The
+# compression ratio of each encoding of gbcodec.py is computed on the host for the same saves.
+
+REPO_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.insert(0, REPO_DIR)
+import gbcodec
+
+DEFAULT_BAUDRATES = [9600, 19200, 38400, 57600, 115200]
+DEFAULT_PROGRAM = os.path.join(REPO_DIR, "software", "bin", "gbdump.bin")
+ZEALEMU = os.path.join(REPO_DIR, "emulator", "bin", "zealemu")
+DUMP_PY = os.path.join(REPO_DIR, "dump.py")
+# Z80 clock and bits per byte on the wire, must match zos.h and serial.c
+CPU_FREQ = 10000000
+BITS_PER_BYTE = 10
+# Header RAM size code for each SRAM size, see cartridge_RAM_size() in main.c
+RAM_SIZE_CODES = {8192: 2, 32768: 3, 65536: 5, 131072: 4}
+# Sessions run for each kind of payload, with the dump.py arguments
+SAVE_SESSIONS = [("dump", []), ("restore", ["-i"]), ("restore -z", ["-i", "-z"])]
+ROM_SESSIONS = [("rom dump", ["-r"])]
+# Host timeout of a session, in seconds, and extra time per byte of payload
+SESSION_TIMEOUT = 120
+SESSION_TIMEOUT_PER_BYTE = 1 / 20000
+
+parser = argparse.ArgumentParser(
+                prog='protobench.py',
+                description='Benchmark complete dump sessions against the emulated Zeal 8-bit Computer'
+            )
+parser.add_argument('-p', dest='program', help='Program to run in the emulator', default=DEFAULT_PROGRAM)
+parser.add_argument('-c', dest='corpus', help='Directory of real .sav files to add to the corpus', required=False)
+parser.add_argument('-b', dest='baudrates', help='Comma-separated list of baudrates',
+                    default=','.join(str(b) for b in DEFAULT_BAUDRATES))
+parser.add_argument('-f', dest='faults', help='Faults to inject on the link, see zealemu -h', required=False)
+args = parser.parse_args()
+
+
+def make_rom_image(size, ram_size=0, fill=b'\0'):
+    """MBC5 cartridge header with the given ROM size, with RAM and battery when ram_size isn't 0"""
+    rom = bytearray(fill * (size // len(fill)))
+    rom[0x134:0x144] = b"PROTOBENCH".ljust(16, b'\0')
+    rom[0x147] = 0x1b if ram_size else 0x19
+    rom[0x148] = (size // 32768).bit_length() - 1
+    rom[0x149] = RAM_SIZE_CODES[ram_size] if ram_size else 0
+    return bytes(rom)
+
+
+def make_corpus():
+    """Synthetic saves and ROMs, plus the real saves given on the command line. Each payload is
+    given with the sessions to run for it."""
+    rng = random.Random(42)
+    saves = [
+        ("all-0xFF 32KB", bytes([0xff]) * 32768),
+        ("random 32KB", bytes(rng.getrandbits(8) for _ in range(32768))),
+        ("random 128KB", bytes(rng.getrandbits(8) for _ in range(131072))),
+    ]
+    # Typical save layout: a few structured records, the rest left to zero
+    save = bytearray(32768)
+    for rec in range(0, 0x2000, 0x200):
+        save[rec:rec + 0x80] = bytes(rng.getrandbits(4) * 3 for _ in range(0x80))
+    saves.append(("save-like 32KB", bytes(save)))
+
+    if args.corpus:
+        for name in sorted(os.listdir(args.corpus)):
+            with open(os.path.join(args.corpus, name), "rb") as f:
+                data = f.read()
+            if len(data) in RAM_SIZE_CODES:
+                saves.append((name[:16], data))
+            else:
+                print("Ignoring %s, unsupported size %d" % (name, len(data)))
+
+    # ROMs, a random 64KB pattern repeated: a common size and a large one, which needs the bank bit 8
+    # of MBC5 and many more bank switches
+    roms = [
+        ("ROM 1MB", make_rom_image(1024 * 1024, fill=bytes(rng.getrandbits(8) for _ in range(65536)))),
+        ("large ROM 8MB", make_rom_image(8 * 1024 * 1024, fill=bytes(rng.getrandbits(8) for _ in range(65536)))),
+    ]
+    return [(name, data, SAVE_SESSIONS) for name, data in saves] + [(name, data, ROM_SESSIONS) for name, data in roms]
+
+
+def run_session(tmp, payload, host_args, baudrate):
+    """Run one session, returns (goodput, zeal CPU seconds, host CPU seconds) or None"""
+    rom = os.path.join(tmp, "bench.gb")
+    sav = os.path.join(tmp, "bench.sav")
+    out = os.path.join(tmp, "out.sav")
+    link = os.path.join(tmp, "ser0")
+    if os.path.exists(out):
+        os.remove(out)
+
+    emu_args = [ZEALEMU, "-r", rom, "-l", link, "-b", str(baudrate), "-t", "5000"]
+    if "-r" in host_args:
+        # The payload is the ROM, dumped to out
+        with open(rom, "wb") as f:
+            f.write(payload)
+        host_args = host_args + ["-o", out]
+    else:
+        with open(rom, "wb") as f:
+            f.write(make_rom_image(32768, len(payload)))
+        with open(sav, "wb") as f:
+            f.write(payload)
+        if "-i" in host_args:
+            # The save is restored in an erased cartridge, which the emulator saves to out on exit
+            host_args = ["-i", sav] + host_args[1:]
+            emu_args += ["-o", out]
+        else:
+            emu_args += ["-s", sav]
+            host_args = host_args + ["-o", out]
+    if args.faults:
+        emu_args += ["-f", args.faults]
+    emu = subprocess.Popen(emu_args + [args.program], stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    while not os.path.exists(link):
+        if emu.poll() is not None:
+            sys.exit("zealemu exited before creating %s:\n%s" % (link, emu.stderr.read()))
+        time.sleep(0.01)
+
+    timeout = SESSION_TIMEOUT + len(payload) * SESSION_TIMEOUT_PER_BYTE
+    before = resource.getrusage(resource.RUSAGE_CHILDREN)
+    host = subprocess.run([sys.executable, DUMP_PY, "-d", link, "-b", str(baudrate)] + host_args,
+                          stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, timeout=timeout)
+    after = resource.getrusage(resource.RUSAGE_CHILDREN)
+    _, stats = emu.communicate(timeout=timeout)
+
+    cycles = re.search(r"T-states: (\d+)", stats)
+    serial = re.search(r"Serial: (\d+) bytes sent, (\d+) bytes received", stats)
+    if host.returncode != 0 or cycles is None or serial is None or not os.path.exists(out):
+        return None
+
+    with open(out, "rb") as f:
+        received = f.read()
+    correct = sum(1 for a, b in zip(received, payload) if a == b)
+    simulated = int(cycles.group(1)) / CPU_FREQ
+    wire = (int(serial.group(1)) + int(serial.group(2))) * BITS_PER_BYTE / baudrate
+    host_cpu = (after.ru_utime - before.ru_utime) + (after.ru_stime - before.ru_stime)
+    return (correct / simulated, simulated - wire, host_cpu)
+
+
+corpus = make_corpus()
+baudrates = [int(b) for b in args.baudrates.split(',')]
+
+print("Program: %s%s" % (args.program, ", faults: " + args.faults if args.faults else ""))
+print()
+print("%-8s %-16s %8s %-10s %12s %12s %12s" % ("Baudrate", "Payload", "Size", "Session",
+                                               "Goodput B/s", "Zeal CPU s", "Host CPU s"))
+with tempfile.TemporaryDirectory() as tmp:
+    for baudrate in baudrates:
+        for name, payload, sessions in corpus:
+            for session, host_args in sessions:
+                result = run_session(tmp, payload, host_args, baudrate)
+                if result is None:
+                    print("%-8d %-16s %8d %-10s %12s" % (baudrate, name, len(payload), session, "failed"))
+                else:
+                    print("%-8d %-16s %8d %-10s %12.0f %12.3f %12.3f" % ((baudrate, name, len(payload), session) + result))
+
+# The dumps send raw data, the ratios below show what each encoding would save on the same saves
+# (encoded size over raw size, lower is better). The compressed restore picks the best of RLE and
+# LZ for each bank.
+print()
+print("%-16s %8s" % ("Ratio", "raw") + "".join(" %8s" % e for e in gbcodec.ENCODERS))
+for name, payload, sessions in corpus:
+    if sessions is not SAVE_SESSIONS:
+        continue
+    ratios = [len(encode(payload)) / len(payload) for encode in gbcodec.ENCODERS.values()]
+    print("%-16s %8.3f" % (name, 1.0) + "".join(" %8.3f" % r for r in ratios))
@@ -0,0 +1,709 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cart.h"
+
+/**
+ * @brief Size of the cartridge RAM, in bytes, from the header byte at offset 0x149
+ */
+static uint32_t cart_ram_size(uint8_t size_value)
+{
+    switch (size_value) {
+        case 1: return 2*1024;
+        case 2: return 8*1024;
+        case 3: return 32*1024;
+        case 4: return 128*1024;
+        case 5: return 64*1024;
+        default: return 0;
+    }
+}
+
+/**
+ * @brief Fill the MBC related fields according to the cartridge type byte.
+ *
+ * @returns 0 on success, -1 if the type is not supported by the model.
+ */
+static int cart_decode_type(cart_t* cart, uint8_t type)
+{
+    cart->type = type;
+    cart->has_rtc = false;
+    cart->has_battery = false;
+
+    switch (type) {
+        case 0x00:
+        case 0x08:
+            cart->mbc = CART_MBC_NONE;
+            break;
+        case 0x09:
+            cart->mbc = CART_MBC_NONE;
+            cart->has_battery = true;
+            break;
+        case 0x01:
+        case 0x02:
+            cart->mbc = CART_MBC1;
+            break;
+        case 0x03:
+            cart->mbc = CART_MBC1;
+            cart->has_battery = true;
+            break;
+        case 0x05:
+            cart->mbc = CART_MBC2;
+            break;
+        case 0x06:
+            cart->mbc = CART_MBC2;
+            cart->has_battery = true;
+            break;
+        case 0x0f:
+        case 0x10:
+            cart->mbc = CART_MBC3;
+            cart->has_rtc = true;
+            cart->has_battery = true;
+            break;
+        case 0x11:
+        case 0x12:
+            cart->mbc = CART_MBC3;
+            break;
+        case 0x13:
+            cart->mbc = CART_MBC3;
+            cart->has_battery = true;
+            break;
+        case 0x19:
+        case 0x1a:
+        case 0x1c:
+        case 0x1d:
+            cart->mbc = CART_MBC5;
+            break;
+        case 0x1b:
+        case 0x1e:
+            cart->mbc = CART_MBC5;
+            cart->has_battery = true;
+            break;
+        case 0x22:
+            cart->mbc = CART_MBC7;
+            cart->has_battery = true;
+            break;
+        case 0xfc:
+            cart->mbc = CART_CAMERA;
+            cart->has_battery = true;
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Recompute the pointers used by `cart_read` and `cart_write` from the MBC registers.
+ */
+static void cart_update_banks(cart_t* cart)
+{
+    const uint32_t rom_banks = cart->rom_size / CART_ROM_BANK_SIZE;
+    uint32_t lo = 0;
+    uint32_t hi = cart->rom_bank;
+    uint32_t ram = cart->ram_bank;
+
+    if (cart->mbc == CART_MBC1) {
+        const int shift = cart->mbc1_multicart ? 4 : 5;
+        if (cart->mbc1_multicart) {
+            hi &= 0xf;
+        }
+        hi |= cart->mbc1_upper << shift;
+        if (cart->mbc1_mode) {
+            lo = cart->mbc1_upper << shift;
+            ram = cart->mbc1_upper;
+        } else {
+            ram = 0;
+        }
+    }
+
+    /* ROM size is always a power of two, unused upper bits of the bank number are ignored */
+    cart->rom_lo = cart->rom + (lo & (rom_banks - 1)) * CART_ROM_BANK_SIZE;
+    cart->rom_hi = cart->rom + (hi & (rom_banks - 1)) * CART_ROM_BANK_SIZE;
+
+    if (cart->mbc == CART_MBC2) {
+        cart->ram_cur = cart->ram;
+        cart->ram_mask = CART_MBC2_RAM_SIZE - 1;
+    } else if (cart->ram_size >= CART_RAM_BANK_SIZE) {
+        const uint32_t ram_banks = cart->ram_size / CART_RAM_BANK_SIZE;
+        cart->ram_cur = cart->ram + (ram & (ram_banks - 1)) * CART_RAM_BANK_SIZE;
+        cart->ram_mask = CART_RAM_BANK_SIZE - 1;
+    } else {
+        /* 2KB RAM (or none), mirrored in the whole 8KB area */
+        cart->ram_cur = cart->ram;
+        cart->ram_mask = cart->ram_size ? cart->ram_size - 1 : 0;
+    }
+}
+
+static uint32_t round_pow2(uint32_t value)
+{
+    uint32_t result = CART_ROM_BANK_SIZE * 2;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+
+int cart_init(cart_t* cart, const uint8_t* rom, uint32_t rom_size)
+{
+    memset(cart, 0, sizeof(cart_t));
+
+    if (rom_size <= CART_HDR_RAM_SIZE || rom_size > 8*1024*1024) {
+        fprintf(stderr, "Invalid ROM size: %u bytes\n", rom_size);
+        return -1;
+    }
+
+    if (cart_decode_type(cart, rom[CART_HDR_TYPE]) != 0) {
+        fprintf(stderr, "Unsupported cartridge type: 0x%02x\n", rom[CART_HDR_TYPE]);
+        return -1;
+    }
+
+    /* Pad the ROM to a power of two so that bank numbers can simply be masked */
+    cart->rom_size = round_pow2(rom_size);
+    cart->rom = malloc(cart->rom_size);
+    if (cart->rom == NULL) {
+        return -1;
+    }
+    memset(cart->rom, 0xff, cart->rom_size);
+    memcpy(cart->rom, rom, rom_size);
+
+    /* Same detection as the Game Boy emulators: the menu and each game of an MBC1M multicart
+     * start with a header, the second game is in the bank 0x10 */
+    if (cart->mbc == CART_MBC1 && cart->rom_size == 1024*1024 &&
+        memcmp(cart->rom + CART_HDR_LOGO, cart->rom + 0x40000 + CART_HDR_LOGO, CART_HDR_LOGO_SIZE) == 0) {
+        cart->mbc1_multicart = true;
+    }
+
+    if (cart->mbc == CART_MBC2) {
+        cart->ram_size = CART_MBC2_RAM_SIZE;
+    } else if (cart->mbc == CART_MBC7) {
+        cart->ram_size = CART_MBC7_EEPROM_SIZE;
+    } else {
+        cart->ram_size = cart_ram_size(rom[CART_HDR_RAM_SIZE]);
+    }
+
+    if (cart->ram_size) {
+        cart->ram = malloc(cart->ram_size);
+        if (cart->ram == NULL) {
+            cart_free(cart);
+            return -1;
+        }
+        memset(cart->ram, 0xff, cart->ram_size);
+    }
+
+    cart_reset(cart);
+    return 0;
+}
+
+
+static uint8_t* read_file(const char* path, uint32_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* data = malloc(length > 0 ? length : 1);
+    if (data != NULL && fread(data, 1, length, file) != (size_t) length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = (uint32_t) length;
+    return data;
+}
+
+
+int cart_load(cart_t* cart, const char* rom_path, const char* sram_path)
+{
+    uint32_t size = 0;
+    uint8_t* rom = read_file(rom_path, &size);
+    if (rom == NULL) {
+        fprintf(stderr, "Could not read ROM file %s\n", rom_path);
+        return -1;
+    }
+
+    const int err = cart_init(cart, rom, size);
+    free(rom);
+    if (err != 0 || sram_path == NULL) {
+        return err;
+    }
+
+    uint8_t* sram = read_file(sram_path, &size);
+    if (sram != NULL) {
+        /* Larger files may contain an RTC footer, only keep the RAM part */
+        memcpy(cart->ram, sram, size < cart->ram_size ? size : cart->ram_size);
+        free(sram);
+    }
+    return 0;
+}
+
+
+int cart_save_sram(const cart_t* cart, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    const size_t written = fwrite(cart->ram, 1, cart->ram_size, file);
+    fclose(file);
+    return written == cart->ram_size ? 0 : -1;
+}
+
+
+void cart_free(cart_t* cart)
+{
+    free(cart->rom);
+    free(cart->ram);
+    cart->rom = NULL;
+    cart->ram = NULL;
+}
+
+
+void cart_reset(cart_t* cart)
+{
+    cart->ram_enabled = false;
+    cart->rom_bank = 1;
+    cart->ram_bank = 0;
+    cart->mbc1_upper = 0;
+    cart->mbc1_mode = 0;
+    cart->mbc3_latch = 0xff;
+    cart->rtc_select = -1;
+    cart->mbc7_ram_enabled2 = false;
+    cart->camera_regs = false;
+    memset(&cart->eeprom, 0, sizeof(cart->eeprom));
+    cart->eeprom.data_out = 1;
+    cart_update_banks(cart);
+}
+
+
+/**
+ * @brief Execute the command shifted in the EEPROM: 2-bit opcode and 8-bit address, the 93LC56
+ *        only uses 7 bits of it. Opcode 0 is extended by the 2 upper bits of the address.
+ */
+static void eeprom_command(cart_t* cart)
+{
+    cart_eeprom_t* eeprom = &cart->eeprom;
+    uint8_t* words = cart->ram;
+
+    eeprom->opcode = (eeprom->shift >> 8) & 3;
+    eeprom->addr = eeprom->shift & 0x7f;
+    eeprom->state = CART_EEPROM_DONE;
+
+    switch (eeprom->opcode) {
+        case 2: /* READ, a dummy 0 bit precedes the data */
+            eeprom->state = CART_EEPROM_READ;
+            eeprom->bits = 0;
+            eeprom->shift = (words[eeprom->addr * 2] << 8) | words[eeprom->addr * 2 + 1];
+            eeprom->data_out = 0;
+            break;
+        case 1: /* WRITE */
+            eeprom->state = CART_EEPROM_DATA;
+            eeprom->bits = 0;
+            break;
+        case 3: /* ERASE */
+            if (eeprom->write_enabled) {
+                words[eeprom->addr * 2] = words[eeprom->addr * 2 + 1] = 0xff;
+                cart->eeprom_writes++;
+            }
+            break;
+        default:
+            switch ((eeprom->shift >> 6) & 3) {
+                case 0: eeprom->write_enabled = false; break;
+                case 3: eeprom->write_enabled = true; break;
+                case 2: /* ERAL */
+                    if (eeprom->write_enabled) {
+                        memset(words, 0xff, CART_MBC7_EEPROM_SIZE);
+                        cart->eeprom_writes++;
+                    }
+                    break;
+                default: /* WRAL */
+                    eeprom->state = CART_EEPROM_DATA;
+                    eeprom->bits = 0;
+                    break;
+            }
+            break;
+    }
+}
+
+
+/**
+ * @brief Rising edge of CLK while CS is high
+ */
+static void eeprom_clock(cart_t* cart)
+{
+    cart_eeprom_t* eeprom = &cart->eeprom;
+    const uint8_t in = (eeprom->lines & CART_MBC7_DI) ? 1 : 0;
+
+    switch (eeprom->state) {
+        case CART_EEPROM_IDLE:
+            if (in) {
+                eeprom->state = CART_EEPROM_COMMAND;
+                eeprom->bits = 0;
+                eeprom->shift = 0;
+            }
+            break;
+        case CART_EEPROM_COMMAND:
+            eeprom->shift = (eeprom->shift << 1) | in;
+            if (++eeprom->bits == 10) {
+                eeprom_command(cart);
+            }
+            break;
+        case CART_EEPROM_DATA:
+            eeprom->shift = (eeprom->shift << 1) | in;
+            if (++eeprom->bits == 16) {
+                if (eeprom->write_enabled) {
+                    /* WRITE or WRAL, the programming is instantaneous: DO reads as ready */
+                    const int first = eeprom->opcode == 1 ? eeprom->addr : 0;
+                    const int last = eeprom->opcode == 1 ? eeprom->addr : 127;
+                    for (int i = first; i <= last; i++) {
+                        cart->ram[i * 2] = eeprom->shift >> 8;
+                        cart->ram[i * 2 + 1] = eeprom->shift & 0xff;
+                    }
+                    cart->eeprom_writes++;
+                }
+                eeprom->state = CART_EEPROM_DONE;
+            }
+            break;
+        case CART_EEPROM_READ:
+            /* Sequential read: after the last bit of a word, continue with the next one */
+            if (eeprom->bits == 16) {
+                eeprom->addr = (eeprom->addr + 1) & 0x7f;
+                eeprom->shift = (cart->ram[eeprom->addr * 2] << 8) | cart->ram[eeprom->addr * 2 + 1];
+                eeprom->bits = 0;
+            }
+            eeprom->data_out = (eeprom->shift >> 15) & 1;
+            eeprom->shift <<= 1;
+            eeprom->bits++;
+            break;
+        case CART_EEPROM_DONE:
+            break;
+    }
+}
+
+
+static void eeprom_write_lines(cart_t* cart, uint8_t value)
+{
+    cart_eeprom_t* eeprom = &cart->eeprom;
+    const uint8_t previous = eeprom->lines;
+
+    eeprom->lines = value & (CART_MBC7_CS | CART_MBC7_CLK | CART_MBC7_DI);
+    if ((value & CART_MBC7_CS) == 0) {
+        /* Deselecting the chip aborts the command, DO reads as ready */
+        eeprom->state = CART_EEPROM_IDLE;
+        eeprom->data_out = 1;
+    } else if ((value & CART_MBC7_CLK) && (previous & CART_MBC7_CLK) == 0) {
+        eeprom_clock(cart);
+    }
+}
+
+
+/**
+ * @brief MBC7 RAM area: the registers at 0xA000-0xAFFF are mirrored every 256 bytes, only the
+ *        EEPROM one is modelled, the accelerometer reads as centered.
+ */
+static uint8_t mbc7_read_reg(cart_t* cart, uint16_t addr)
+{
+    if (addr >= 0xb000) {
+        return 0xff;
+    }
+    switch (addr & 0xf0) {
+        case 0x20: case 0x40: return 0x00;
+        case 0x30: case 0x50: return 0x81;
+        case CART_MBC7_REG:
+            cart->ram_reads++;
+            return cart->eeprom.lines | cart->eeprom.data_out;
+        default:   return 0xff;
+    }
+}
+
+
+static uint8_t cart_read_ram(cart_t* cart, uint16_t addr)
+{
+    if (!cart->ram_enabled) {
+        return 0xff;
+    }
+
+    if (cart->mbc == CART_MBC7) {
+        return cart->mbc7_ram_enabled2 ? mbc7_read_reg(cart, addr) : 0xff;
+    }
+
+    if (cart->rtc_select >= 0) {
+        return cart->rtc_latched[cart->rtc_select];
+    }
+
+    if (cart->camera_regs) {
+        /* Only the first register can be read, the sensor is never capturing */
+        return 0x00;
+    }
+
+    if (cart->ram_size == 0) {
+        return 0xff;
+    }
+
+    cart->ram_reads++;
+    const uint8_t value = cart->ram_cur[addr & cart->ram_mask];
+    /* MBC2 RAM is only 4-bit wide, upper bits are left floating and usually read as 1 */
+    return cart->mbc == CART_MBC2 ? (value | 0xf0) : value;
+}
+
+
+/**
+ * @brief Next random number of the contact fault generator, between 0 and 1
+ */
+static double cart_contact_rng(cart_t* cart)
+{
+    cart->contact_rng ^= cart->contact_rng >> 12;
+    cart->contact_rng ^= cart->contact_rng << 25;
+    cart->contact_rng ^= cart->contact_rng >> 27;
+    return (double) ((cart->contact_rng * 0x2545F4914F6CDD1DULL) >> 11) / (double) (1ULL << 53);
+}
+
+
+static uint8_t cart_contact_fault(cart_t* cart, uint8_t value)
+{
+    if (cart_contact_rng(cart) < cart->contact_flip) {
+        cart->contact_flips++;
+        value ^= 1 << (int) (cart_contact_rng(cart) * 8);
+    }
+    return value;
+}
+
+
+uint8_t cart_read(cart_t* cart, uint16_t addr)
+{
+    uint8_t value;
+
+    if (addr < 0x4000) {
+        value = cart->rom_lo[addr];
+    } else if (addr < 0x8000) {
+        value = cart->rom_hi[addr - 0x4000];
+    } else if ((addr & 0xe000) == 0xa000) {
+        value = cart_read_ram(cart, addr);
+    } else {
+        return 0xff;
+    }
+    return cart->contact_flip > 0 ? cart_contact_fault(cart, value) : value;
+}
+
+
+void cart_set_contact_faults(cart_t* cart, double rate, uint64_t seed)
+{
+    cart->contact_flip = rate;
+    cart->contact_rng = seed ? seed : 1;
+}
+
+
+void cart_read_block(cart_t* cart, uint16_t addr, uint8_t* dst, uint16_t len)
+{
+    if (addr < 0x4000) {
+        memcpy(dst, cart->rom_lo + addr, len);
+    } else if (addr < 0x8000) {
+        memcpy(dst, cart->rom_hi + (addr - 0x4000), len);
+    } else if (cart->mbc != CART_MBC2 && cart->ram_enabled && cart->rtc_select < 0 && !cart->camera_regs &&
+               (addr & 0xe000) == 0xa000 && cart->ram_mask == CART_RAM_BANK_SIZE - 1 &&
+               (addr & cart->ram_mask) + len <= CART_RAM_BANK_SIZE) {
+        cart->ram_reads += len;
+        memcpy(dst, cart->ram_cur + (addr & cart->ram_mask), len);
+    } else {
+        for (uint16_t i = 0; i < len; i++) {
+            dst[i] = cart_read(cart, addr + i);
+        }
+    }
+}
+
+
+static void cart_write_ram(cart_t* cart, uint16_t addr, uint8_t value)
+{
+    if (!cart->ram_enabled) {
+        return;
+    }
+
+    if (cart->mbc == CART_MBC7) {
+        if (cart->mbc7_ram_enabled2 && addr < 0xb000 && (addr & 0xf0) == CART_MBC7_REG) {
+            cart->ram_writes++;
+            eeprom_write_lines(cart, value);
+        }
+        return;
+    }
+
+    if (cart->rtc_select >= 0) {
+        /* Writing the RTC registers sets the live counters directly */
+        cart->rtc[cart->rtc_select] = value;
+        return;
+    }
+
+    if (cart->camera_regs) {
+        return;
+    }
+
+    if (cart->ram_size == 0) {
+        return;
+    }
+
+    cart->ram_writes++;
+    if (cart->mbc == CART_MBC2) {
+        value &= 0xf;
+    }
+    cart->ram_cur[addr & cart->ram_mask] = value;
+}
+
+
+static void cart_latch_rtc(cart_t* cart, uint8_t value)
+{
+    /* Writing 0x00 then 0x01 copies the live counters in the latched registers */
+    if (cart->mbc3_latch == 0 && value == 1) {
+        memcpy(cart->rtc_latched, cart->rtc, CART_RTC_COUNT);
+    }
+    cart->mbc3_latch = value;
+}
+
+
+void cart_write(cart_t* cart, uint16_t addr, uint8_t value)
+{
+    if (addr >= 0x8000) {
+        if ((addr & 0xe000) == 0xa000) {
+            cart_write_ram(cart, addr, value);
+        }
+        return;
+    }
+
+    cart->reg_writes++;
+
+    switch (cart->mbc) {
+        case CART_MBC_NONE:
+            return;
+
+        case CART_MBC1:
+            if (addr < 0x2000) {
+                cart->ram_enabled = (value & 0xf) == 0xa;
+            } else if (addr < 0x4000) {
+                /* Bank 0 is translated to 1, the check is done on the 5 bits only */
+                value &= 0x1f;
+                cart->rom_bank = value ? value : 1;
+            } else if (addr < 0x6000) {
+                cart->mbc1_upper = value & 3;
+            } else {
+                cart->mbc1_mode = value & 1;
+            }
+            break;
+
+        case CART_MBC2:
+            /* Address bit 8 selects between RAM enable (0) and ROM bank (1) registers */
+            if (addr >= 0x4000) {
+                return;
+            }
+            if ((addr & 0x100) == 0) {
+                cart->ram_enabled = (value & 0xf) == 0xa;
+            } else {
+                value &= 0xf;
+                cart->rom_bank = value ? value : 1;
+            }
+            break;
+
+        case CART_MBC3:
+            if (addr < 0x2000) {
+                cart->ram_enabled = (value & 0xf) == 0xa;
+            } else if (addr < 0x4000) {
+                value &= 0x7f;
+                cart->rom_bank = value ? value : 1;
+            } else if (addr < 0x6000) {
+                if (cart->has_rtc && value >= 0x08 && value <= 0x0c) {
+                    cart->rtc_select = value - 0x08;
+                } else {
+                    cart->rtc_select = -1;
+                    cart->ram_bank = value & 0x7;
+                }
+            } else if (cart->has_rtc) {
+                cart_latch_rtc(cart, value);
+            }
+            break;
+
+        case CART_MBC5:
+            if (addr < 0x2000) {
+                /* MBC5 checks the whole byte, not only the lower nibble */
+                cart->ram_enabled = value == 0xa;
+            } else if (addr < 0x3000) {
+                cart->rom_bank = (cart->rom_bank & 0x100) | value;
+            } else if (addr < 0x4000) {
+                cart->rom_bank = (cart->rom_bank & 0xff) | ((value & 1) << 8);
+            } else if (addr < 0x6000) {
+                /* On rumble cartridges, bit 3 drives the motor */
+                cart->ram_bank = (cart->type == 0x1c || cart->type == 0x1d || cart->type == 0x1e) ?
+                                 (value & 0x7) : (value & 0xf);
+            }
+            break;
+
+        case CART_CAMERA:
+            if (addr < 0x2000) {
+                cart->ram_enabled = (value & 0xf) == 0xa;
+            } else if (addr < 0x4000) {
+                value &= 0x3f;
+                cart->rom_bank = value ? value : 1;
+            } else if (addr < 0x6000) {
+                cart->camera_regs = (value & 0x10) != 0;
+                cart->ram_bank = value & 0xf;
+            }
+            break;
+
+        case CART_MBC7:
+            if (addr < 0x2000) {
+                cart->ram_enabled = (value & 0xf) == 0xa;
+            } else if (addr < 0x4000) {
+                value &= 0x7f;
+                cart->rom_bank = value ? value : 1;
+            } else if (addr < 0x6000) {
+                cart->mbc7_ram_enabled2 = value == 0x40;
+            }
+            break;
+    }
+
+    cart_update_banks(cart);
+}
+
+
+void cart_rtc_advance(cart_t* cart, uint32_t seconds)
+{
+    uint8_t* rtc = cart->rtc;
+
+    if (!cart->has_rtc || (rtc[CART_RTC_DH] & CART_RTC_DH_HALT)) {
+        return;
+    }
+
+    uint32_t total = rtc[CART_RTC_S] + seconds;
+    rtc[CART_RTC_S] = total % 60;
+    total = rtc[CART_RTC_M] + total / 60;
+    rtc[CART_RTC_M] = total % 60;
+    total = rtc[CART_RTC_H] + total / 60;
+    rtc[CART_RTC_H] = total % 24;
+
+    uint32_t days = rtc[CART_RTC_DL] + ((rtc[CART_RTC_DH] & CART_RTC_DH_DAY_MSB) << 8) + total / 24;
+    if (days >= 512) {
+        rtc[CART_RTC_DH] |= CART_RTC_DH_CARRY;
+        days &= 511;
+    }
+    rtc[CART_RTC_DL] = days & 0xff;
+    rtc[CART_RTC_DH] = (rtc[CART_RTC_DH] & ~CART_RTC_DH_DAY_MSB) | (days >> 8);
+}
+
+
+const char* cart_mbc_name(const cart_t* cart)
+{
+    switch (cart->mbc) {
+        case CART_MBC1: return cart->mbc1_multicart ? "MBC1M" : "MBC1";
+        case CART_MBC2: return "MBC2";
+        case CART_MBC3: return cart->has_rtc ? "MBC3+RTC" : "MBC3";
+        case CART_MBC5: return "MBC5";
+        case CART_MBC7: return "MBC7";
+        case CART_CAMERA: return "Camera";
+        default:        return "ROM only";
+    }
+}
@@ -0,0 +1,202 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Software model of a Gameboy cartridge, as seen from the cartridge connector.
+ * Addresses given to the functions below are cartridge addresses (0x0000-0xFFFF),
+ * exactly as a Gameboy would put them on the bus.
+ */
+
+/* Cartridge header offsets */
+#define CART_HDR_TITLE      0x134
+#define CART_HDR_TYPE       0x147
+#define CART_HDR_ROM_SIZE   0x148
+#define CART_HDR_RAM_SIZE   0x149
+#define CART_HDR_LOGO       0x104
+#define CART_HDR_LOGO_SIZE  48
+
+/* Size of a ROM bank and of an SRAM bank */
+#define CART_ROM_BANK_SIZE  (16*1024)
+#define CART_RAM_BANK_SIZE  (8*1024)
+
+/* MBC2 has 512 half-bytes of RAM built in the controller */
+#define CART_MBC2_RAM_SIZE  512
+
+/* MBC7 saves in a 93LC56 serial EEPROM, 128 16-bit words, stored most significant byte first */
+#define CART_MBC7_EEPROM_SIZE   256
+/* MBC7 EEPROM lines, in the register mirrored at 0xAx8x */
+#define CART_MBC7_REG           0x80
+#define CART_MBC7_CS            (1 << 7)
+#define CART_MBC7_CLK           (1 << 6)
+#define CART_MBC7_DI            (1 << 1)
+#define CART_MBC7_DO            (1 << 0)
+
+typedef enum {
+    CART_MBC_NONE = 0,
+    CART_MBC1,
+    CART_MBC2,
+    CART_MBC3,
+    CART_MBC5,
+    CART_MBC7,
+    /* Game Boy Camera: MBC5-like, bank 0x10 and above select the sensor registers instead of the SRAM */
+    CART_CAMERA,
+} cart_mbc_t;
+
+/**
+ * MBC3 real-time clock registers, selected by writing 0x08-0x0C to the 0x4000 register.
+ */
+typedef enum {
+    CART_RTC_S = 0,
+    CART_RTC_M,
+    CART_RTC_H,
+    CART_RTC_DL,
+    CART_RTC_DH,
+    CART_RTC_COUNT
+} cart_rtc_reg_t;
+
+#define CART_RTC_DH_DAY_MSB     (1 << 0)
+#define CART_RTC_DH_HALT        (1 << 6)
+#define CART_RTC_DH_CARRY       (1 << 7)
+
+/**
+ * State of the MBC7 EEPROM, commands are shifted in on the rising edges of CLK while CS is high
+ */
+typedef enum {
+    CART_EEPROM_IDLE = 0,
+    /* Start bit received, shifting in the opcode and the address */
+    CART_EEPROM_COMMAND,
+    /* Shifting in the data of WRITE or WRAL */
+    CART_EEPROM_DATA,
+    /* Shifting out the words, the address is incremented after each word */
+    CART_EEPROM_READ,
+    /* Command complete, waiting for CS to go low */
+    CART_EEPROM_DONE,
+} cart_eeprom_state_t;
+
+typedef struct {
+    cart_eeprom_state_t state;
+    /* Lines as last written by the software, DO as driven by the EEPROM */
+    uint8_t  lines;
+    uint8_t  data_out;
+    bool     write_enabled;
+    uint8_t  bits;
+    uint16_t shift;
+    uint8_t  opcode;
+    uint8_t  addr;
+} cart_eeprom_t;
+
+typedef struct {
+    cart_mbc_t mbc;
+    /* Cartridge type byte, from the header */
+    uint8_t    type;
+    bool       has_rtc;
+    bool       has_battery;
+
+    uint8_t*   rom;
+    uint32_t   rom_size;
+    uint8_t*   ram;
+    uint32_t   ram_size;
+
+    /* MBC registers, as written by the software */
+    bool       ram_enabled;
+    uint16_t   rom_bank;
+    uint8_t    ram_bank;
+    uint8_t    mbc1_upper;
+    uint8_t    mbc1_mode;
+    /* MBC1M multicart: bit 4 of the ROM bank register is not connected, the upper register
+     * selects the ROM bank bits 4-5 instead of 5-6 */
+    bool       mbc1_multicart;
+    uint8_t    mbc3_latch;
+    /* MBC7: the RAM area is only accessible when 0x40 was also written to the 0x4000 register */
+    bool       mbc7_ram_enabled2;
+    /* Camera: the sensor registers are mapped in the RAM area instead of the SRAM */
+    bool       camera_regs;
+    cart_eeprom_t eeprom;
+
+    /* Pointers derived from the registers above, updated on each register write
+     * so that reads are a single lookup */
+    const uint8_t* rom_lo;
+    const uint8_t* rom_hi;
+    uint8_t*       ram_cur;
+    uint16_t       ram_mask;
+
+    /* RTC: live registers, latched copy and the register currently mapped (-1 if SRAM is) */
+    uint8_t    rtc[CART_RTC_COUNT];
+    uint8_t    rtc_latched[CART_RTC_COUNT];
+    int8_t     rtc_select;
+
+    /* Flaky contact between the adapter and the cartridge: probability for a read to get one of its
+     * bits flipped, 0 for a clean contact */
+    double     contact_flip;
+    uint64_t   contact_rng;
+
+    /* Statistics, useful to compare software strategies */
+    uint32_t   reg_writes;
+    uint32_t   ram_reads;
+    uint32_t   ram_writes;
+    uint32_t   eeprom_writes;
+    uint32_t   contact_flips;
+} cart_t;
+
+
+/**
+ * @brief Initialize a cartridge from a ROM image already in memory. The ROM is copied.
+ *        The MBC is deduced from the header type byte, the SRAM is filled with 0xFF.
+ *        A 1MB MBC1 ROM with a second Nintendo logo at 0x40104 is wired as an MBC1M multicart.
+ *        The MBC7 EEPROM is loaded and saved like the SRAM.
+ *
+ * @returns 0 on success, -1 on error (unsupported type or invalid size).
+ */
+int cart_init(cart_t* cart, const uint8_t* rom, uint32_t rom_size);
+
+/**
+ * @brief Load a ROM file and, optionally, an SRAM image (`sram_path` can be NULL).
+ *        A missing SRAM file is not an error, the RAM is left blank (0xFF).
+ */
+int cart_load(cart_t* cart, const char* rom_path, const char* sram_path);
+
+/**
+ * @brief Save the cartridge SRAM to a file (same format as dump.py output).
+ */
+int cart_save_sram(const cart_t* cart, const char* path);
+
+void cart_free(cart_t* cart);
+
+/**
+ * @brief Bring the MBC back to its power-on state, the memory content is kept.
+ */
+void cart_reset(cart_t* cart);
+
+uint8_t cart_read(cart_t* cart, uint16_t addr);
+void cart_write(cart_t* cart, uint16_t addr, uint8_t value);
+
+/**
+ * @brief Copy `len` bytes starting at cartridge address `addr`. Faster than calling
+ *        `cart_read` in a loop, the range must not cross a 16KB boundary.
+ */
+void cart_read_block(cart_t* cart, uint16_t addr, uint8_t* dst, uint16_t len);
+
+/**
+ * @brief Let the MBC3 clock run for the given number of seconds (no effect when halted
+ *        or when the cartridge has no RTC).
+ */
+void cart_rtc_advance(cart_t* cart, uint32_t seconds);
+
+/**
+ * @brief Simulate a dirty or badly seated cartridge: each read done with `cart_read` has a `rate`
+ *        probability to get one of its bits flipped. The random generator is seeded, so that a
+ *        run can be reproduced. `cart_read_block` is not affected.
+ */
+void cart_set_contact_faults(cart_t* cart, double rate, uint64_t seed);
+
+/**
+ * @brief Human readable name of the cartridge MBC
+ */
+const char* cart_mbc_name(const cart_t* cart);
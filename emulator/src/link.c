@@ -0,0 +1,164 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "link.h"
+
+
+/**
+ * @brief xorshift64* generator, returns a number in [0, 1)
+ */
+static double rng_next(link_t* link)
+{
+    link->rng ^= link->rng >> 12;
+    link->rng ^= link->rng << 25;
+    link->rng ^= link->rng >> 27;
+    return (double) ((link->rng * 0x2545F4914F6CDD1DULL) >> 11) / (double) (1ULL << 53);
+}
+
+
+/**
+ * @brief Byte seen by a receiver whose clock is off by `error` percent. The line holds the start bit,
+ *        the 8 data bits (LSB first), the stop bit, then stays idle (high). The receiver samples in the
+ *        middle of each bit according to its own clock, so the error accumulates along the byte.
+ */
+static uint8_t baud_garble(uint8_t byte, double error)
+{
+    uint8_t res = 0;
+
+    for (int i = 0; i < 8; i++) {
+        const int bit = (int) ((1.5 + i) * (1.0 + error / 100.0));
+        int value = 1;
+        if (bit <= 0) {
+            value = 0;
+        } else if (bit <= 8) {
+            value = (byte >> (bit - 1)) & 1;
+        }
+        res |= value << i;
+    }
+    return res;
+}
+
+
+int link_parse(link_config_t* config, const char* spec)
+{
+    char* copy = strdup(spec);
+    char* saveptr = NULL;
+    int err = 0;
+
+    memset(config, 0, sizeof(link_config_t));
+    config->dirs = (1 << LINK_DIR_TX) | (1 << LINK_DIR_RX);
+    config->stall_ms = 100;
+    config->seed = 1;
+
+    for (char* token = strtok_r(copy, ",", &saveptr); token != NULL; token = strtok_r(NULL, ",", &saveptr)) {
+        char* value = strchr(token, '=');
+        if (value == NULL) {
+            err = -1;
+            break;
+        }
+        *value++ = 0;
+
+        if (strcmp(token, "flip") == 0) {
+            config->flip = atof(value);
+        } else if (strcmp(token, "drop") == 0) {
+            config->drop = atof(value);
+        } else if (strcmp(token, "dup") == 0) {
+            config->dup = atof(value);
+        } else if (strcmp(token, "stall") == 0) {
+            char* ms = strchr(value, ':');
+            config->stall = atof(value);
+            if (ms != NULL) {
+                config->stall_ms = strtoul(ms + 1, NULL, 0);
+            }
+        } else if (strcmp(token, "baud") == 0) {
+            config->baud_error = atof(value);
+        } else if (strcmp(token, "seed") == 0) {
+            config->seed = strtoull(value, NULL, 0);
+        } else if (strcmp(token, "dir") == 0 && strcmp(value, "tx") == 0) {
+            config->dirs = 1 << LINK_DIR_TX;
+        } else if (strcmp(token, "dir") == 0 && strcmp(value, "rx") == 0) {
+            config->dirs = 1 << LINK_DIR_RX;
+        } else if (strcmp(token, "dir") == 0 && strcmp(value, "both") == 0) {
+            config->dirs = (1 << LINK_DIR_TX) | (1 << LINK_DIR_RX);
+        } else {
+            err = -1;
+            break;
+        }
+    }
+
+    free(copy);
+    return err;
+}
+
+
+void link_init(link_t* link, const link_config_t* config)
+{
+    memset(link, 0, sizeof(link_t));
+    link->config = *config;
+    /* xorshift must not be seeded with 0 */
+    link->rng = config->seed ? config->seed : 1;
+    for (int i = 0; i < 256; i++) {
+        link->baud_table[i] = baud_garble(i, config->baud_error);
+    }
+}
+
+
+uint32_t link_apply(link_t* link, int dir, const uint8_t* in, uint32_t len, uint8_t* out, uint32_t* stall_ms)
+{
+    const link_config_t* config = &link->config;
+    link_stats_t* stats = &link->stats[dir];
+    uint32_t count = 0;
+
+    stats->bytes += len;
+
+    if ((config->dirs & (1 << dir)) == 0) {
+        memcpy(out, in, len);
+        return len;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t byte = link->baud_table[in[i]];
+
+        if (byte != in[i]) {
+            stats->garbled++;
+        }
+        if (config->stall > 0 && rng_next(link) < config->stall) {
+            stats->stalls++;
+            *stall_ms += config->stall_ms;
+        }
+        if (config->drop > 0 && rng_next(link) < config->drop) {
+            stats->dropped++;
+            continue;
+        }
+        if (config->flip > 0 && rng_next(link) < config->flip) {
+            stats->flipped++;
+            byte ^= 1 << (int) (rng_next(link) * 8);
+        }
+        out[count++] = byte;
+        if (config->dup > 0 && rng_next(link) < config->dup) {
+            stats->duplicated++;
+            out[count++] = byte;
+        }
+    }
+
+    return count;
+}
+
+
+void link_print_stats(const link_t* link, FILE* out)
+{
+    static const char* names[2] = { "Zeal to host", "Host to Zeal" };
+
+    for (int dir = 0; dir < 2; dir++) {
+        const link_stats_t* stats = &link->stats[dir];
+        fprintf(out, "Link %s: %llu bytes, %llu flipped, %llu dropped, %llu duplicated, "
+                     "%llu garbled by the baudrate error, %llu stalls\n", names[dir],
+                (unsigned long long) stats->bytes, (unsigned long long) stats->flipped,
+                (unsigned long long) stats->dropped, (unsigned long long) stats->duplicated,
+                (unsigned long long) stats->garbled, (unsigned long long) stats->stalls);
+    }
+}
@@ -0,0 +1,73 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Fault injection on the emulated serial link. Each direction can be affected independently,
+ * all the rates are probabilities per byte. The random generator is seeded so that a run
+ * can be reproduced.
+ */
+
+/* Direction of the transfer, seen from the Zeal side */
+#define LINK_DIR_TX     0
+#define LINK_DIR_RX     1
+
+typedef struct {
+    /* Probability for a byte to get one of its bits flipped */
+    double   flip;
+    double   drop;
+    double   dup;
+    /* Probability for the link to stall `stall_ms` milliseconds before a byte */
+    double   stall;
+    uint32_t stall_ms;
+    /* Clock error of the receiver, in percent, positive when it is slower than the sender */
+    double   baud_error;
+    /* Bit mask of the affected directions: (1 << LINK_DIR_TX) | (1 << LINK_DIR_RX) */
+    uint8_t  dirs;
+    uint64_t seed;
+} link_config_t;
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t flipped;
+    uint64_t dropped;
+    uint64_t duplicated;
+    uint64_t garbled;
+    uint64_t stalls;
+} link_stats_t;
+
+typedef struct {
+    link_config_t config;
+    uint64_t      rng;
+    /* Byte received for each byte sent, because of the baudrate mismatch */
+    uint8_t       baud_table[256];
+    link_stats_t  stats[2];
+} link_t;
+
+
+/**
+ * @brief Parse a configuration string such as "flip=1e-4,drop=1e-5,stall=1e-4:200,dir=tx".
+ *        Keys: flip, drop, dup, stall (probability[:milliseconds]), baud (percent),
+ *        dir (tx, rx or both) and seed.
+ *
+ * @returns 0 on success, -1 if the string is invalid.
+ */
+int link_parse(link_config_t* config, const char* spec);
+
+void link_init(link_t* link, const link_config_t* config);
+
+/**
+ * @brief Send `len` bytes through the faulty link in the given direction. `out` must be able
+ *        to hold `2 * len` bytes (every byte may be duplicated).
+ *
+ * @returns the number of bytes that come out of the link, the stall time is added to `stall_ms`.
+ */
+uint32_t link_apply(link_t* link, int dir, const uint8_t* in, uint32_t len, uint8_t* out, uint32_t* stall_ms);
+
+void link_print_stats(const link_t* link, FILE* out);
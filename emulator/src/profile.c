@@ -0,0 +1,142 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "profile.h"
+
+
+static void add_symbol(profile_t* prof, const char* name, size_t len, uint16_t addr)
+{
+    if (len == 0 || len >= PROFILE_NAME_MAX || prof->count == PROFILE_MAX_FUNCS) {
+        return;
+    }
+    /* Keep the first symbol found for an address */
+    if (prof->index[addr] >= 0) {
+        return;
+    }
+    profile_func_t* func = &prof->funcs[prof->count];
+    memcpy(func->name, name, len);
+    func->name[len] = 0;
+    func->addr = addr;
+    prof->index[addr] = prof->count++;
+}
+
+
+/**
+ * @brief Parse a linker record of an SDCC debug file, for example:
+ *          L:G$main$0_0$0:4123
+ *          L:Fmain$map_cart_phys$0_0$0:40A2
+ *        End of function records (L:X...) are ignored.
+ */
+static void parse_cdb_line(profile_t* prof, const char* line)
+{
+    if (strncmp(line, "L:", 2) != 0 || (line[2] != 'G' && line[2] != 'F')) {
+        return;
+    }
+    const char* name = strchr(line, '$');
+    const char* end = name ? strchr(name + 1, '$') : NULL;
+    const char* addr = strrchr(line, ':');
+    if (end == NULL || addr == NULL || addr < end) {
+        return;
+    }
+    name++;
+    add_symbol(prof, name, end - name, (uint16_t) strtoul(addr + 1, NULL, 16));
+}
+
+
+/**
+ * @brief Parse a NoICE record: DEF _main 0x4123. Only C symbols (leading underscore) are kept.
+ */
+static void parse_noi_line(profile_t* prof, const char* line)
+{
+    char name[PROFILE_NAME_MAX];
+    unsigned addr;
+
+    if (sscanf(line, "DEF %47s %x", name, &addr) == 2 && name[0] == '_') {
+        add_symbol(prof, name + 1, strlen(name + 1), addr);
+    }
+}
+
+
+int profile_load(profile_t* prof, const char* path)
+{
+    char line[256];
+
+    memset(prof, 0, sizeof(profile_t));
+    memset(prof->index, 0xff, sizeof(prof->index));
+
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open symbols file %s\n", path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == 'L') {
+            parse_cdb_line(prof, line);
+        } else {
+            parse_noi_line(prof, line);
+        }
+    }
+    fclose(file);
+    return prof->count;
+}
+
+
+void profile_reset(profile_t* prof)
+{
+    for (int i = 0; i < prof->count; i++) {
+        prof->funcs[i].calls = 0;
+        prof->funcs[i].cycles = 0;
+    }
+    prof->depth = 0;
+}
+
+
+static inline bool is_call(uint8_t op)
+{
+    /* CALL nn, CALL cc,nn */
+    return op == 0xcd || (op & 0xc7) == 0xc4;
+}
+
+
+void profile_step(profile_t* prof, z80_t* cpu, uint8_t prev_op)
+{
+    /* Returned from the function on top of the call stack? */
+    while (prof->depth > 0) {
+        const profile_frame_t* frame = &prof->frames[prof->depth - 1];
+        if (cpu->pc != frame->ret || (int16_t) (cpu->sp - frame->sp) < 2) {
+            break;
+        }
+        profile_func_t* func = &prof->funcs[frame->func];
+        func->calls++;
+        func->cycles += cpu->cycles - frame->start;
+        prof->depth--;
+    }
+
+    const int16_t func = prof->index[cpu->pc];
+    if (func >= 0 && is_call(prev_op) && prof->depth < PROFILE_MAX_DEPTH) {
+        profile_frame_t* frame = &prof->frames[prof->depth++];
+        frame->func = func;
+        frame->ret = cpu->read(cpu->ctx, cpu->sp) | (cpu->read(cpu->ctx, cpu->sp + 1) << 8);
+        frame->sp = cpu->sp;
+        frame->start = cpu->cycles;
+    }
+}
+
+
+const profile_func_t* profile_find(const profile_t* prof, const char* name)
+{
+    if (name[0] == '_') {
+        name++;
+    }
+    for (int i = 0; i < prof->count; i++) {
+        if (strcmp(prof->funcs[i].name, name) == 0) {
+            return &prof->funcs[i];
+        }
+    }
+    return NULL;
+}
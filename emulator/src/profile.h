@@ -0,0 +1,67 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "z80.h"
+
+/**
+ * Function-level profiler: counts the calls and the inclusive T-states of each function
+ * whose address is found in the symbols file generated by the SDCC linker.
+ */
+
+#define PROFILE_NAME_MAX    48
+#define PROFILE_MAX_FUNCS   512
+#define PROFILE_MAX_DEPTH   64
+
+typedef struct {
+    char     name[PROFILE_NAME_MAX];
+    uint16_t addr;
+    uint64_t calls;
+    uint64_t cycles;
+} profile_func_t;
+
+typedef struct {
+    int16_t  func;
+    uint16_t ret;
+    uint16_t sp;
+    uint64_t start;
+} profile_frame_t;
+
+typedef struct {
+    profile_func_t  funcs[PROFILE_MAX_FUNCS];
+    int             count;
+    /* Function index for each address of the 64KB address space, -1 if none */
+    int16_t         index[0x10000];
+    profile_frame_t frames[PROFILE_MAX_DEPTH];
+    int             depth;
+} profile_t;
+
+
+/**
+ * @brief Load the symbols from a linker-generated file: either a NoICE file (.noi, globals only)
+ *        or a debug file (.cdb, also contains the static functions, requires `--debug`).
+ *
+ * @returns the number of symbols loaded, -1 on error.
+ */
+int profile_load(profile_t* prof, const char* path);
+
+/**
+ * @brief Clear the counters, the symbols are kept.
+ */
+void profile_reset(profile_t* prof);
+
+/**
+ * @brief Must be called before executing each instruction. `prev_op` is the opcode of the
+ *        previously executed instruction, it lets us differentiate calls from jumps.
+ */
+void profile_step(profile_t* prof, z80_t* cpu, uint8_t prev_op);
+
+/**
+ * @brief Look for a function by name, the leading underscore added by SDCC is optional.
+ */
+const profile_func_t* profile_find(const profile_t* prof, const char* name);
@@ -0,0 +1,255 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "serial.h"
+
+/* A byte on the wire is made of a start bit, 8 data bits and a stop bit */
+#define SERIAL_BITS_PER_BYTE    10
+
+
+int serial_open(serial_t* serial, const char* link, uint32_t baudrate)
+{
+    struct termios attr;
+
+    memset(serial, 0, sizeof(serial_t));
+    serial->baudrate = baudrate;
+    serial->rx_pending = -1;
+
+    serial->master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (serial->master < 0 || grantpt(serial->master) != 0 || unlockpt(serial->master) != 0) {
+        perror("Could not create pseudo-terminal");
+        return -1;
+    }
+    strncpy(serial->path, ptsname(serial->master), sizeof(serial->path) - 1);
+
+    serial->slave = open(serial->path, O_RDWR | O_NOCTTY);
+    if (serial->slave < 0) {
+        perror("Could not open pseudo-terminal slave");
+        return -1;
+    }
+
+    /* Raw mode on both ends: the data must not be altered by the line discipline */
+    tcgetattr(serial->slave, &attr);
+    cfmakeraw(&attr);
+    tcsetattr(serial->slave, TCSANOW, &attr);
+
+    if (link != NULL) {
+        unlink(link);
+        if (symlink(serial->path, link) != 0) {
+            perror("Could not create the serial link");
+            return -1;
+        }
+        strncpy(serial->link_path, link, sizeof(serial->link_path) - 1);
+    }
+    return 0;
+}
+
+
+void serial_open_script(serial_t* serial, const uint8_t* script, uint32_t len, uint32_t baudrate)
+{
+    memset(serial, 0, sizeof(serial_t));
+    serial->master = -1;
+    serial->slave = -1;
+    serial->script = script;
+    serial->script_len = len;
+    serial->baudrate = baudrate;
+    serial->rx_pending = -1;
+}
+
+
+static int read_raw(serial_t* serial, uint8_t* buffer, uint16_t len, int timeout_ms)
+{
+    struct pollfd fd = { .fd = serial->master, .events = POLLIN };
+    uint16_t total = 0;
+
+    if (serial->master < 0) {
+        /* Scripted host: once the script is over, behave as a silent host */
+        const uint32_t left = serial->script_len - serial->script_pos;
+        total = len < left ? len : left;
+        memcpy(buffer, serial->script + serial->script_pos, total);
+        serial->script_pos += total;
+        return total;
+    }
+
+    while (total < len) {
+        const int ready = poll(&fd, 1, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            return -1;
+        } else if (ready == 0) {
+            break;
+        } else if (ready < 0) {
+            continue;
+        }
+
+        const ssize_t rd = read(serial->master, buffer + total, len - total);
+        if (rd < 0) {
+            /* EIO is returned while nothing is connected on the other end, retry */
+            if (errno == EIO || errno == EAGAIN || errno == EINTR) {
+                usleep(1000);
+                continue;
+            }
+            return -1;
+        }
+        total += rd;
+    }
+
+    return total;
+}
+
+
+static void stall(serial_t* serial, uint32_t ms)
+{
+    if (ms == 0) {
+        return;
+    }
+    serial->stall_ms += ms;
+    /* The host really has to wait, the scripted host doesn't care */
+    if (serial->master >= 0) {
+        usleep(ms * 1000);
+    }
+}
+
+
+int serial_read(serial_t* serial, uint8_t* buffer, uint16_t len, int timeout_ms)
+{
+    uint16_t total = 0;
+
+    if (serial->link == NULL) {
+        const int got = read_raw(serial, buffer, len, timeout_ms);
+        if (got > 0) {
+            serial->rx_bytes += got;
+        }
+        return got;
+    }
+
+    /* Go through the faulty link byte per byte, each byte can turn into 0, 1 or 2 bytes */
+    while (total < len) {
+        uint8_t in;
+        uint8_t out[2];
+        uint32_t stall_ms = 0;
+
+        if (serial->rx_pending >= 0) {
+            buffer[total++] = serial->rx_pending;
+            serial->rx_pending = -1;
+            continue;
+        }
+
+        const int got = read_raw(serial, &in, 1, timeout_ms);
+        if (got < 0) {
+            return -1;
+        } else if (got == 0) {
+            break;
+        }
+
+        const uint32_t count = link_apply(serial->link, LINK_DIR_RX, &in, 1, out, &stall_ms);
+        stall(serial, stall_ms);
+        if (count > 0) {
+            buffer[total++] = out[0];
+        }
+        if (count > 1) {
+            serial->rx_pending = out[1];
+        }
+    }
+
+    serial->rx_bytes += total;
+    return total;
+}
+
+
+int serial_available(serial_t* serial)
+{
+    if (serial->rx_pending >= 0) {
+        return 1;
+    }
+    if (serial->master < 0) {
+        return serial->script_pos < serial->script_len;
+    }
+    struct pollfd fd = { .fd = serial->master, .events = POLLIN };
+    return poll(&fd, 1, 0) > 0;
+}
+
+
+static int write_raw(serial_t* serial, const uint8_t* buffer, uint32_t len)
+{
+    uint32_t total = 0;
+
+    if (serial->master < 0) {
+        return len;
+    }
+
+    while (total < len) {
+        const ssize_t wr = write(serial->master, buffer + total, len - total);
+        if (wr < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        total += wr;
+    }
+
+    return total;
+}
+
+
+int serial_write(serial_t* serial, const uint8_t* buffer, uint16_t len)
+{
+    if (serial->link == NULL) {
+        if (write_raw(serial, buffer, len) < 0) {
+            return -1;
+        }
+    } else {
+        uint8_t out[2 * len];
+        uint32_t stall_ms = 0;
+        const uint32_t count = link_apply(serial->link, LINK_DIR_TX, buffer, len, out, &stall_ms);
+        stall(serial, stall_ms);
+        if (write_raw(serial, out, count) < 0) {
+            return -1;
+        }
+    }
+
+    /* From the program point of view, everything was sent */
+    serial->tx_bytes += len;
+    return len;
+}
+
+
+void serial_close(serial_t* serial)
+{
+    /* Give the host some time to read what was sent last, closing the master discards it */
+    int pending = 0;
+    if (serial->master < 0) {
+        return;
+    }
+    for (int i = 0; i < 100 && ioctl(serial->slave, FIONREAD, &pending) == 0 && pending > 0; i++) {
+        usleep(10000);
+    }
+
+    if (serial->link_path[0]) {
+        unlink(serial->link_path);
+    }
+    if (serial->slave >= 0) {
+        close(serial->slave);
+    }
+    if (serial->master >= 0) {
+        close(serial->master);
+    }
+}
+
+
+uint64_t serial_cycles(const serial_t* serial, uint32_t bytes, uint32_t cpu_freq)
+{
+    return (uint64_t) bytes * SERIAL_BITS_PER_BYTE * cpu_freq / serial->baudrate;
+}
@@ -0,0 +1,76 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "link.h"
+
+/**
+ * Host end of the emulated #SER0 UART: a pseudo-terminal that dump.py can open
+ * like any other serial node, or a scripted host that sends a fixed sequence of
+ * bytes and discards what it receives (used by the benchmarks).
+ */
+typedef struct {
+    /* Scripted host: bytes to send to the program, -1 for the master when used */
+    const uint8_t* script;
+    uint32_t script_len;
+    uint32_t script_pos;
+
+    int      master;
+    /* The slave end is kept opened so that the master doesn't get EIO when the host
+     * script is not connected yet (or between two sessions) */
+    int      slave;
+    char     path[64];
+    char     link_path[256];
+    uint32_t baudrate;
+    uint64_t tx_bytes;
+    uint64_t rx_bytes;
+
+    /* Optional fault injection, NULL for a perfect link */
+    link_t*  link;
+    /* Total time the link stalled, in milliseconds */
+    uint64_t stall_ms;
+    /* Byte duplicated by the link, not given to the program yet */
+    int16_t  rx_pending;
+} serial_t;
+
+/**
+ * @brief Create the pseudo-terminal. If `link` is not NULL, a symbolic link with
+ *        that name is created to point to the slave node.
+ *
+ * @returns 0 on success, -1 on error.
+ */
+int serial_open(serial_t* serial, const char* link, uint32_t baudrate);
+
+/**
+ * @brief Create a scripted host: the program will receive `len` bytes from `script`
+ *        and its output is discarded.
+ */
+void serial_open_script(serial_t* serial, const uint8_t* script, uint32_t len, uint32_t baudrate);
+
+/**
+ * @brief Read exactly `len` bytes from the host, unless `timeout_ms` elapses
+ *        without any byte received (negative timeout waits forever).
+ *
+ * @returns the number of bytes read, -1 on error.
+ */
+int serial_read(serial_t* serial, uint8_t* buffer, uint16_t len, int timeout_ms);
+
+/**
+ * @brief Check whether the host sent bytes that were not read yet, without blocking.
+ */
+int serial_available(serial_t* serial);
+
+int serial_write(serial_t* serial, const uint8_t* buffer, uint16_t len);
+
+void serial_close(serial_t* serial);
+
+/**
+ * @brief Number of CPU T-states needed to transfer `bytes` bytes at the configured
+ *        baudrate. On Zeal 8-bit Computer, the UART is driven by the CPU itself,
+ *        so this time is spent in the driver.
+ */
+uint64_t serial_cycles(const serial_t* serial, uint32_t bytes, uint32_t cpu_freq);
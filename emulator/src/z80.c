@@ -0,0 +1,796 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stddef.h>
+#include "z80.h"
+
+/* Shorter names for the 8-bit registers */
+#define A       (cpu->af.b.h)
+#define F       (cpu->af.b.l)
+#define B       (cpu->bc.b.h)
+#define C       (cpu->bc.b.l)
+#define D       (cpu->de.b.h)
+#define E       (cpu->de.b.l)
+
+#define FLAGS_XY(v)     ((v) & (Z80_FLAG_X | Z80_FLAG_Y))
+#define FLAGS_SZ(v)     (((v) & Z80_FLAG_S) | ((v) == 0 ? Z80_FLAG_Z : 0))
+
+/* Index register used by the instruction being executed */
+typedef enum {
+    IDX_HL = 0,
+    IDX_IX,
+    IDX_IY,
+} idx_t;
+
+
+static inline uint8_t parity(uint8_t v)
+{
+    return __builtin_parity(v) ? 0 : Z80_FLAG_PV;
+}
+
+static inline uint8_t rd(z80_t* cpu, uint16_t addr)
+{
+    return cpu->read(cpu->ctx, addr);
+}
+
+static inline void wr(z80_t* cpu, uint16_t addr, uint8_t value)
+{
+    cpu->write(cpu->ctx, addr, value);
+}
+
+static inline uint16_t rd16(z80_t* cpu, uint16_t addr)
+{
+    return rd(cpu, addr) | (rd(cpu, addr + 1) << 8);
+}
+
+static inline void wr16(z80_t* cpu, uint16_t addr, uint16_t value)
+{
+    wr(cpu, addr, value & 0xff);
+    wr(cpu, addr + 1, value >> 8);
+}
+
+static inline uint8_t fetch(z80_t* cpu)
+{
+    return rd(cpu, cpu->pc++);
+}
+
+static inline uint16_t fetch16(z80_t* cpu)
+{
+    const uint16_t value = rd16(cpu, cpu->pc);
+    cpu->pc += 2;
+    return value;
+}
+
+/* Fetch an opcode byte, this increments the refresh register */
+static inline uint8_t fetch_op(z80_t* cpu)
+{
+    cpu->r = (cpu->r & 0x80) | ((cpu->r + 1) & 0x7f);
+    return fetch(cpu);
+}
+
+void z80_push(z80_t* cpu, uint16_t value)
+{
+    cpu->sp -= 2;
+    wr16(cpu, cpu->sp, value);
+}
+
+uint16_t z80_pop(z80_t* cpu)
+{
+    const uint16_t value = rd16(cpu, cpu->sp);
+    cpu->sp += 2;
+    return value;
+}
+
+void z80_reset(z80_t* cpu)
+{
+    cpu->af.w = 0xffff;
+    cpu->sp = 0xffff;
+    cpu->pc = 0;
+    cpu->i = 0;
+    cpu->r = 0;
+    cpu->iff1 = false;
+    cpu->iff2 = false;
+    cpu->im = 0;
+    cpu->halted = false;
+    cpu->cycles = 0;
+}
+
+
+/**
+ * 8-bit arithmetic, `op` is the ALU operation encoded in bits 3-5 of the opcode:
+ * ADD, ADC, SUB, SBC, AND, XOR, OR, CP
+ */
+static void alu8(z80_t* cpu, int op, uint8_t value)
+{
+    const uint8_t a = A;
+    unsigned res;
+    unsigned carry = 0;
+
+    switch (op) {
+        case 1: /* ADC */
+            carry = F & Z80_FLAG_C;
+            /* fall-through */
+        case 0: /* ADD */
+            res = a + value + carry;
+            A = res;
+            F = FLAGS_SZ(A) | FLAGS_XY(A) | ((a ^ value ^ res) & Z80_FLAG_H) |
+                ((((a ^ ~value) & (a ^ res)) & 0x80) ? Z80_FLAG_PV : 0) |
+                ((res >> 8) & Z80_FLAG_C);
+            break;
+        case 3: /* SBC */
+            carry = F & Z80_FLAG_C;
+            /* fall-through */
+        case 2: /* SUB */
+        case 7: /* CP */
+            res = a - value - carry;
+            F = FLAGS_SZ(res & 0xff) | ((a ^ value ^ res) & Z80_FLAG_H) |
+                ((((a ^ value) & (a ^ res)) & 0x80) ? Z80_FLAG_PV : 0) |
+                ((res >> 8) & Z80_FLAG_C) | Z80_FLAG_N;
+            if (op == 7) {
+                /* CP takes the undocumented flags from the operand */
+                F |= FLAGS_XY(value);
+            } else {
+                A = res;
+                F |= FLAGS_XY(A);
+            }
+            break;
+        case 4: /* AND */
+            A &= value;
+            F = FLAGS_SZ(A) | FLAGS_XY(A) | parity(A) | Z80_FLAG_H;
+            break;
+        case 5: /* XOR */
+            A ^= value;
+            F = FLAGS_SZ(A) | FLAGS_XY(A) | parity(A);
+            break;
+        case 6: /* OR */
+            A |= value;
+            F = FLAGS_SZ(A) | FLAGS_XY(A) | parity(A);
+            break;
+    }
+}
+
+static uint8_t inc8(z80_t* cpu, uint8_t value)
+{
+    const uint8_t res = value + 1;
+    F = (F & Z80_FLAG_C) | FLAGS_SZ(res) | FLAGS_XY(res) |
+        ((value & 0xf) == 0xf ? Z80_FLAG_H : 0) | (value == 0x7f ? Z80_FLAG_PV : 0);
+    return res;
+}
+
+static uint8_t dec8(z80_t* cpu, uint8_t value)
+{
+    const uint8_t res = value - 1;
+    F = (F & Z80_FLAG_C) | FLAGS_SZ(res) | FLAGS_XY(res) | Z80_FLAG_N |
+        ((value & 0xf) == 0 ? Z80_FLAG_H : 0) | (value == 0x80 ? Z80_FLAG_PV : 0);
+    return res;
+}
+
+/**
+ * CB-prefixed rotations and shifts: RLC, RRC, RL, RR, SLA, SRA, SLL, SRL
+ */
+static uint8_t rot8(z80_t* cpu, int op, uint8_t value)
+{
+    uint8_t res = 0;
+    uint8_t carry = 0;
+
+    switch (op) {
+        case 0: carry = value >> 7;  res = (value << 1) | carry; break;
+        case 1: carry = value & 1;   res = (value >> 1) | (carry << 7); break;
+        case 2: carry = value >> 7;  res = (value << 1) | (F & Z80_FLAG_C); break;
+        case 3: carry = value & 1;   res = (value >> 1) | ((F & Z80_FLAG_C) << 7); break;
+        case 4: carry = value >> 7;  res = value << 1; break;
+        case 5: carry = value & 1;   res = (value >> 1) | (value & 0x80); break;
+        case 6: carry = value >> 7;  res = (value << 1) | 1; break;
+        case 7: carry = value & 1;   res = value >> 1; break;
+    }
+    F = FLAGS_SZ(res) | FLAGS_XY(res) | parity(res) | carry;
+    return res;
+}
+
+static uint16_t add16(z80_t* cpu, uint16_t a, uint16_t b)
+{
+    const uint32_t res = a + b;
+    F = (F & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV)) | FLAGS_XY(res >> 8) |
+        (((a ^ b ^ res) >> 8) & Z80_FLAG_H) | ((res >> 16) & Z80_FLAG_C);
+    return res;
+}
+
+static uint16_t adc16(z80_t* cpu, uint16_t a, uint16_t b)
+{
+    const uint32_t res = a + b + (F & Z80_FLAG_C);
+    const uint16_t res16 = res;
+    F = ((res16 >> 8) & Z80_FLAG_S) | (res16 == 0 ? Z80_FLAG_Z : 0) | FLAGS_XY(res16 >> 8) |
+        (((a ^ b ^ res) >> 8) & Z80_FLAG_H) |
+        ((((a ^ ~b) & (a ^ res)) & 0x8000) ? Z80_FLAG_PV : 0) | ((res >> 16) & Z80_FLAG_C);
+    return res16;
+}
+
+static uint16_t sbc16(z80_t* cpu, uint16_t a, uint16_t b)
+{
+    const uint32_t res = a - b - (F & Z80_FLAG_C);
+    const uint16_t res16 = res;
+    F = ((res16 >> 8) & Z80_FLAG_S) | (res16 == 0 ? Z80_FLAG_Z : 0) | FLAGS_XY(res16 >> 8) |
+        (((a ^ b ^ res) >> 8) & Z80_FLAG_H) |
+        ((((a ^ b) & (a ^ res)) & 0x8000) ? Z80_FLAG_PV : 0) |
+        ((res >> 16) & Z80_FLAG_C) | Z80_FLAG_N;
+    return res16;
+}
+
+static void daa(z80_t* cpu)
+{
+    uint8_t correction = 0;
+    uint8_t carry = F & Z80_FLAG_C;
+    const uint8_t a = A;
+
+    if ((F & Z80_FLAG_H) || (a & 0xf) > 9) {
+        correction |= 0x06;
+    }
+    if (carry || a > 0x99) {
+        correction |= 0x60;
+        carry = Z80_FLAG_C;
+    }
+    A = (F & Z80_FLAG_N) ? a - correction : a + correction;
+    F = (F & Z80_FLAG_N) | FLAGS_SZ(A) | FLAGS_XY(A) | parity(A) |
+        ((a ^ A) & Z80_FLAG_H) | carry;
+}
+
+static bool condition(z80_t* cpu, int cc)
+{
+    switch (cc) {
+        case 0: return !(F & Z80_FLAG_Z);
+        case 1: return F & Z80_FLAG_Z;
+        case 2: return !(F & Z80_FLAG_C);
+        case 3: return F & Z80_FLAG_C;
+        case 4: return !(F & Z80_FLAG_PV);
+        case 5: return F & Z80_FLAG_PV;
+        case 6: return !(F & Z80_FLAG_S);
+        default: return F & Z80_FLAG_S;
+    }
+}
+
+
+/**
+ * @brief Get a pointer to the 8-bit register encoded as `r` in the opcode (6, (HL), is not valid).
+ *        H and L are replaced by the index register halves when `hl` is IX or IY.
+ */
+static uint8_t* reg8(z80_t* cpu, int r, z80_pair_t* hl)
+{
+    switch (r) {
+        case 0: return &B;
+        case 1: return &C;
+        case 2: return &D;
+        case 3: return &E;
+        case 4: return &hl->b.h;
+        case 5: return &hl->b.l;
+        default: return &A;
+    }
+}
+
+/* Register pair encoded as `p` in the opcode, the last entry is SP */
+static uint16_t* reg16(z80_t* cpu, int p, z80_pair_t* hl)
+{
+    switch (p) {
+        case 0: return &cpu->bc.w;
+        case 1: return &cpu->de.w;
+        case 2: return &hl->w;
+        default: return &cpu->sp;
+    }
+}
+
+/* Same as above but the last entry is AF, used by PUSH and POP */
+static uint16_t* reg16_af(z80_t* cpu, int p, z80_pair_t* hl)
+{
+    return p == 3 ? &cpu->af.w : reg16(cpu, p, hl);
+}
+
+/**
+ * @brief Address of the (HL) operand: HL itself, or IX/IY plus the displacement byte.
+ */
+static uint16_t operand_addr(z80_t* cpu, idx_t idx, z80_pair_t* hl)
+{
+    if (idx == IDX_HL) {
+        return hl->w;
+    }
+    return hl->w + (int8_t) fetch(cpu);
+}
+
+
+static int exec_cb(z80_t* cpu, idx_t idx, z80_pair_t* hl)
+{
+    uint16_t addr = hl->w;
+    uint8_t op;
+
+    if (idx != IDX_HL) {
+        /* DDCB d op: the displacement comes before the opcode */
+        addr = hl->w + (int8_t) fetch(cpu);
+        op = fetch(cpu);
+    } else {
+        op = fetch_op(cpu);
+    }
+
+    const int x = op >> 6;
+    const int y = (op >> 3) & 7;
+    const int z = op & 7;
+    const bool mem = idx != IDX_HL || z == 6;
+    /* Undocumented DDCB forms also copy the result to a register */
+    uint8_t* reg = (z == 6) ? NULL : reg8(cpu, z, &cpu->hl);
+    uint8_t value = mem ? rd(cpu, addr) : *reg;
+    int cycles;
+
+    if (x == 1) {
+        /* BIT y, value */
+        const uint8_t res = value & (1 << y);
+        F = (F & Z80_FLAG_C) | Z80_FLAG_H | (res & Z80_FLAG_S) |
+            (res == 0 ? (Z80_FLAG_Z | Z80_FLAG_PV) : 0) |
+            FLAGS_XY(mem ? (addr >> 8) : value);
+        if (idx != IDX_HL) {
+            return 20;
+        }
+        return mem ? 12 : 8;
+    }
+
+    if (x == 0) {
+        value = rot8(cpu, y, value);
+    } else if (x == 2) {
+        value &= ~(1 << y);
+    } else {
+        value |= 1 << y;
+    }
+
+    if (mem) {
+        wr(cpu, addr, value);
+        cycles = (idx != IDX_HL) ? 23 : 15;
+    } else {
+        cycles = 8;
+    }
+    if (reg != NULL) {
+        *reg = value;
+    }
+    return cycles;
+}
+
+
+static int exec_block(z80_t* cpu, int y, int z)
+{
+    const int dir = (y & 1) ? -1 : 1;
+    const bool repeat = y >= 6;
+    uint8_t value;
+
+    switch (z) {
+        case 0: /* LDI, LDD, LDIR, LDDR */
+            value = rd(cpu, cpu->hl.w);
+            wr(cpu, cpu->de.w, value);
+            cpu->hl.w += dir;
+            cpu->de.w += dir;
+            cpu->bc.w--;
+            value += A;
+            F = (F & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_C)) | (value & Z80_FLAG_X) |
+                ((value << 4) & Z80_FLAG_Y) | (cpu->bc.w ? Z80_FLAG_PV : 0);
+            if (repeat && cpu->bc.w) {
+                cpu->pc -= 2;
+                return 21;
+            }
+            return 16;
+
+        case 1: { /* CPI, CPD, CPIR, CPDR */
+            value = rd(cpu, cpu->hl.w);
+            const uint8_t res = A - value;
+            cpu->hl.w += dir;
+            cpu->bc.w--;
+            F = (F & Z80_FLAG_C) | FLAGS_SZ(res) | ((A ^ value ^ res) & Z80_FLAG_H) |
+                (cpu->bc.w ? Z80_FLAG_PV : 0) | Z80_FLAG_N;
+            if (repeat && cpu->bc.w && res != 0) {
+                cpu->pc -= 2;
+                return 21;
+            }
+            return 16;
+        }
+
+        case 2: /* INI, IND, INIR, INDR */
+            value = cpu->in(cpu->ctx, cpu->bc.w);
+            wr(cpu, cpu->hl.w, value);
+            cpu->hl.w += dir;
+            B--;
+            F = FLAGS_SZ(B) | FLAGS_XY(B) | Z80_FLAG_N;
+            if (repeat && B) {
+                cpu->pc -= 2;
+                return 21;
+            }
+            return 16;
+
+        default: /* OUTI, OUTD, OTIR, OTDR */
+            value = rd(cpu, cpu->hl.w);
+            B--;
+            cpu->out(cpu->ctx, cpu->bc.w, value);
+            cpu->hl.w += dir;
+            F = FLAGS_SZ(B) | FLAGS_XY(B) | Z80_FLAG_N;
+            if (repeat && B) {
+                cpu->pc -= 2;
+                return 21;
+            }
+            return 16;
+    }
+}
+
+
+static int exec_ed(z80_t* cpu)
+{
+    const uint8_t op = fetch_op(cpu);
+    const int x = op >> 6;
+    const int y = (op >> 3) & 7;
+    const int z = op & 7;
+    const int p = y >> 1;
+    const int q = y & 1;
+    uint8_t value;
+    uint16_t addr;
+
+    if (x == 2 && z <= 3 && y >= 4) {
+        return exec_block(cpu, y, z);
+    }
+
+    if (x != 1) {
+        /* Invalid instruction, acts as two NOPs */
+        return 8;
+    }
+
+    switch (z) {
+        case 0:
+            value = cpu->in(cpu->ctx, cpu->bc.w);
+            if (y != 6) {
+                *reg8(cpu, y, &cpu->hl) = value;
+            }
+            F = (F & Z80_FLAG_C) | FLAGS_SZ(value) | FLAGS_XY(value) | parity(value);
+            return 12;
+        case 1:
+            cpu->out(cpu->ctx, cpu->bc.w, y == 6 ? 0 : *reg8(cpu, y, &cpu->hl));
+            return 12;
+        case 2:
+            if (q == 0) {
+                cpu->hl.w = sbc16(cpu, cpu->hl.w, *reg16(cpu, p, &cpu->hl));
+            } else {
+                cpu->hl.w = adc16(cpu, cpu->hl.w, *reg16(cpu, p, &cpu->hl));
+            }
+            return 15;
+        case 3:
+            addr = fetch16(cpu);
+            if (q == 0) {
+                wr16(cpu, addr, *reg16(cpu, p, &cpu->hl));
+            } else {
+                *reg16(cpu, p, &cpu->hl) = rd16(cpu, addr);
+            }
+            return 20;
+        case 4:
+            value = A;
+            A = 0;
+            alu8(cpu, 2, value);
+            return 8;
+        case 5:
+            /* RETN and RETI */
+            cpu->iff1 = cpu->iff2;
+            cpu->pc = z80_pop(cpu);
+            return 14;
+        case 6:
+            cpu->im = (y & 3) == 0 ? 0 : (y & 3) - 1;
+            return 8;
+        default:
+            switch (y) {
+                case 0: cpu->i = A; return 9;
+                case 1: cpu->r = A; return 9;
+                case 2:
+                case 3:
+                    A = (y == 2) ? cpu->i : cpu->r;
+                    F = (F & Z80_FLAG_C) | FLAGS_SZ(A) | FLAGS_XY(A) | (cpu->iff2 ? Z80_FLAG_PV : 0);
+                    return 9;
+                case 4: /* RRD */
+                    value = rd(cpu, cpu->hl.w);
+                    wr(cpu, cpu->hl.w, (A << 4) | (value >> 4));
+                    A = (A & 0xf0) | (value & 0xf);
+                    F = (F & Z80_FLAG_C) | FLAGS_SZ(A) | FLAGS_XY(A) | parity(A);
+                    return 18;
+                case 5: /* RLD */
+                    value = rd(cpu, cpu->hl.w);
+                    wr(cpu, cpu->hl.w, (value << 4) | (A & 0xf));
+                    A = (A & 0xf0) | (value >> 4);
+                    F = (F & Z80_FLAG_C) | FLAGS_SZ(A) | FLAGS_XY(A) | parity(A);
+                    return 18;
+                default:
+                    return 8;
+            }
+    }
+}
+
+
+/**
+ * @brief Execute an unprefixed opcode, or a DD/FD-prefixed one when `idx` is not HL.
+ *        The returned T-states don't include the index prefix.
+ */
+static int exec_main(z80_t* cpu, uint8_t op, idx_t idx)
+{
+    z80_pair_t* hl = (idx == IDX_IX) ? &cpu->ix : (idx == IDX_IY) ? &cpu->iy : &cpu->hl;
+    /* Extra T-states taken by the displacement byte of (IX+d) operands */
+    const int disp_cycles = (idx == IDX_HL) ? 0 : 8;
+    const int x = op >> 6;
+    const int y = (op >> 3) & 7;
+    const int z = op & 7;
+    const int p = y >> 1;
+    const int q = y & 1;
+    uint16_t addr;
+    uint16_t tmp;
+    uint8_t value;
+
+    switch (x) {
+    case 0:
+        switch (z) {
+        case 0:
+            switch (y) {
+                case 0:
+                    return 4;
+                case 1:
+                    tmp = cpu->af.w;
+                    cpu->af.w = cpu->af_;
+                    cpu->af_ = tmp;
+                    return 4;
+                case 2: /* DJNZ */
+                    value = fetch(cpu);
+                    if (--B) {
+                        cpu->pc += (int8_t) value;
+                        return 13;
+                    }
+                    return 8;
+                case 3:
+                    value = fetch(cpu);
+                    cpu->pc += (int8_t) value;
+                    return 12;
+                default:
+                    value = fetch(cpu);
+                    if (condition(cpu, y - 4)) {
+                        cpu->pc += (int8_t) value;
+                        return 12;
+                    }
+                    return 7;
+            }
+        case 1:
+            if (q == 0) {
+                *reg16(cpu, p, hl) = fetch16(cpu);
+                return 10;
+            }
+            hl->w = add16(cpu, hl->w, *reg16(cpu, p, hl));
+            return 11;
+        case 2:
+            switch (y) {
+                case 0: wr(cpu, cpu->bc.w, A); return 7;
+                case 1: A = rd(cpu, cpu->bc.w); return 7;
+                case 2: wr(cpu, cpu->de.w, A); return 7;
+                case 3: A = rd(cpu, cpu->de.w); return 7;
+                case 4: wr16(cpu, fetch16(cpu), hl->w); return 16;
+                case 5: hl->w = rd16(cpu, fetch16(cpu)); return 16;
+                case 6: wr(cpu, fetch16(cpu), A); return 13;
+                default: A = rd(cpu, fetch16(cpu)); return 13;
+            }
+        case 3:
+            if (q == 0) {
+                (*reg16(cpu, p, hl))++;
+            } else {
+                (*reg16(cpu, p, hl))--;
+            }
+            return 6;
+        case 4:
+        case 5:
+            if (y == 6) {
+                addr = operand_addr(cpu, idx, hl);
+                value = rd(cpu, addr);
+                wr(cpu, addr, z == 4 ? inc8(cpu, value) : dec8(cpu, value));
+                return 11 + disp_cycles;
+            } else {
+                uint8_t* reg = reg8(cpu, y, hl);
+                *reg = (z == 4) ? inc8(cpu, *reg) : dec8(cpu, *reg);
+                return 4;
+            }
+        case 6:
+            if (y == 6) {
+                addr = operand_addr(cpu, idx, hl);
+                wr(cpu, addr, fetch(cpu));
+                /* LD (IX+d), n overlaps the displacement and the immediate fetch */
+                return (idx == IDX_HL) ? 10 : 15;
+            }
+            *reg8(cpu, y, hl) = fetch(cpu);
+            return 7;
+        default:
+            switch (y) {
+                case 0: /* RLCA */
+                    A = (A << 1) | (A >> 7);
+                    F = (F & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV)) | FLAGS_XY(A) | (A & 1);
+                    break;
+                case 1: /* RRCA */
+                    F = (F & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV)) | (A & 1);
+                    A = (A >> 1) | (A << 7);
+                    F |= FLAGS_XY(A);
+                    break;
+                case 2: /* RLA */
+                    value = A >> 7;
+                    A = (A << 1) | (F & Z80_FLAG_C);
+                    F = (F & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV)) | FLAGS_XY(A) | value;
+                    break;
+                case 3: /* RRA */
+                    value = A & 1;
+                    A = (A >> 1) | ((F & Z80_FLAG_C) << 7);
+                    F = (F & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV)) | FLAGS_XY(A) | value;
+                    break;
+                case 4:
+                    daa(cpu);
+                    break;
+                case 5: /* CPL */
+                    A = ~A;
+                    F = (F & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV | Z80_FLAG_C)) |
+                        FLAGS_XY(A) | Z80_FLAG_H | Z80_FLAG_N;
+                    break;
+                case 6: /* SCF */
+                    F = (F & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV)) | FLAGS_XY(A) | Z80_FLAG_C;
+                    break;
+                default: /* CCF */
+                    F = ((F & (Z80_FLAG_S | Z80_FLAG_Z | Z80_FLAG_PV | Z80_FLAG_C)) |
+                         ((F & Z80_FLAG_C) << 4) | FLAGS_XY(A)) ^ Z80_FLAG_C;
+                    break;
+            }
+            return 4;
+        }
+
+    case 1:
+        if (op == 0x76) {
+            /* HALT: stay on this instruction */
+            cpu->halted = true;
+            cpu->pc--;
+            return 4;
+        }
+        if (y == 6) {
+            /* LD (HL), r: the source register is never an index register half */
+            addr = operand_addr(cpu, idx, hl);
+            wr(cpu, addr, *reg8(cpu, z, &cpu->hl));
+            return 7 + disp_cycles;
+        }
+        if (z == 6) {
+            addr = operand_addr(cpu, idx, hl);
+            *reg8(cpu, y, &cpu->hl) = rd(cpu, addr);
+            return 7 + disp_cycles;
+        }
+        *reg8(cpu, y, hl) = *reg8(cpu, z, hl);
+        return 4;
+
+    case 2:
+        if (z == 6) {
+            addr = operand_addr(cpu, idx, hl);
+            alu8(cpu, y, rd(cpu, addr));
+            return 7 + disp_cycles;
+        }
+        alu8(cpu, y, *reg8(cpu, z, hl));
+        return 4;
+
+    default:
+        switch (z) {
+        case 0:
+            if (condition(cpu, y)) {
+                cpu->pc = z80_pop(cpu);
+                return 11;
+            }
+            return 5;
+        case 1:
+            if (q == 0) {
+                *reg16_af(cpu, p, hl) = z80_pop(cpu);
+                return 10;
+            }
+            switch (p) {
+                case 0:
+                    cpu->pc = z80_pop(cpu);
+                    return 10;
+                case 1: /* EXX */
+                    tmp = cpu->bc.w; cpu->bc.w = cpu->bc_; cpu->bc_ = tmp;
+                    tmp = cpu->de.w; cpu->de.w = cpu->de_; cpu->de_ = tmp;
+                    tmp = cpu->hl.w; cpu->hl.w = cpu->hl_; cpu->hl_ = tmp;
+                    return 4;
+                case 2:
+                    cpu->pc = hl->w;
+                    return 4;
+                default:
+                    cpu->sp = hl->w;
+                    return 6;
+            }
+        case 2:
+            addr = fetch16(cpu);
+            if (condition(cpu, y)) {
+                cpu->pc = addr;
+            }
+            return 10;
+        case 3:
+            switch (y) {
+                case 0:
+                    cpu->pc = fetch16(cpu);
+                    return 10;
+                case 1:
+                    /* CB prefix, handled by the caller */
+                    return 0;
+                case 2:
+                    value = fetch(cpu);
+                    cpu->out(cpu->ctx, (A << 8) | value, A);
+                    return 11;
+                case 3:
+                    value = fetch(cpu);
+                    A = cpu->in(cpu->ctx, (A << 8) | value);
+                    return 11;
+                case 4: /* EX (SP), HL */
+                    tmp = rd16(cpu, cpu->sp);
+                    wr16(cpu, cpu->sp, hl->w);
+                    hl->w = tmp;
+                    return 19;
+                case 5: /* EX DE, HL is never affected by the index prefix */
+                    tmp = cpu->de.w;
+                    cpu->de.w = cpu->hl.w;
+                    cpu->hl.w = tmp;
+                    return 4;
+                case 6:
+                    cpu->iff1 = cpu->iff2 = false;
+                    return 4;
+                default:
+                    cpu->iff1 = cpu->iff2 = true;
+                    return 4;
+            }
+        case 4:
+            addr = fetch16(cpu);
+            if (condition(cpu, y)) {
+                z80_push(cpu, cpu->pc);
+                cpu->pc = addr;
+                return 17;
+            }
+            return 10;
+        case 5:
+            if (q == 0) {
+                z80_push(cpu, *reg16_af(cpu, p, hl));
+                return 11;
+            }
+            /* Only CALL nn reaches here, the prefixes are handled by the caller */
+            addr = fetch16(cpu);
+            z80_push(cpu, cpu->pc);
+            cpu->pc = addr;
+            return 17;
+        case 6:
+            alu8(cpu, y, fetch(cpu));
+            return 7;
+        default:
+            z80_push(cpu, cpu->pc);
+            cpu->pc = y * 8;
+            return 11;
+        }
+    }
+}
+
+
+int z80_step(z80_t* cpu)
+{
+    idx_t idx = IDX_HL;
+    int cycles = 0;
+    uint8_t op = fetch_op(cpu);
+
+    /* Consecutive index prefixes: only the last one is taken into account */
+    while (op == 0xdd || op == 0xfd) {
+        idx = (op == 0xdd) ? IDX_IX : IDX_IY;
+        cycles += 4;
+        op = fetch_op(cpu);
+    }
+
+    if (op == 0xed) {
+        /* ED instructions ignore any previous index prefix */
+        cycles += exec_ed(cpu);
+    } else if (op == 0xcb) {
+        cycles += exec_cb(cpu, idx, idx == IDX_IX ? &cpu->ix : idx == IDX_IY ? &cpu->iy : &cpu->hl);
+        /* DDCB/FDCB T-states returned by exec_cb already include the index prefix */
+        if (idx != IDX_HL) {
+            cycles -= 4;
+        }
+    } else {
+        cycles += exec_main(cpu, op, idx);
+    }
+
+    cpu->cycles += cycles;
+    return cycles;
+}
@@ -0,0 +1,81 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Minimal Z80 core, counting T-states. All the documented instructions are implemented,
+ * as well as the undocumented IXH/IXL/IYH/IYL and DDCB/FDCB register variants that
+ * SDCC may generate. Interrupts are not emulated.
+ */
+
+#define Z80_FLAG_C      (1 << 0)
+#define Z80_FLAG_N      (1 << 1)
+#define Z80_FLAG_PV     (1 << 2)
+#define Z80_FLAG_X      (1 << 3)
+#define Z80_FLAG_H      (1 << 4)
+#define Z80_FLAG_Y      (1 << 5)
+#define Z80_FLAG_Z      (1 << 6)
+#define Z80_FLAG_S      (1 << 7)
+
+/* Register pair, the host is assumed to be little-endian */
+typedef union {
+    uint16_t w;
+    struct {
+        uint8_t l;
+        uint8_t h;
+    } b;
+} z80_pair_t;
+
+typedef struct z80_t {
+    z80_pair_t af;
+    z80_pair_t bc;
+    z80_pair_t de;
+    z80_pair_t hl;
+    z80_pair_t ix;
+    z80_pair_t iy;
+    uint16_t   sp;
+    uint16_t   pc;
+    /* Alternate registers */
+    uint16_t   af_;
+    uint16_t   bc_;
+    uint16_t   de_;
+    uint16_t   hl_;
+    uint8_t    i;
+    uint8_t    r;
+    bool       iff1;
+    bool       iff2;
+    uint8_t    im;
+    bool       halted;
+
+    /* Total number of T-states executed since the reset */
+    uint64_t   cycles;
+
+    /* Bus callbacks, `ctx` is given back as the first parameter */
+    void*      ctx;
+    uint8_t  (*read)(void* ctx, uint16_t addr);
+    void     (*write)(void* ctx, uint16_t addr, uint8_t value);
+    uint8_t  (*in)(void* ctx, uint16_t port);
+    void     (*out)(void* ctx, uint16_t port, uint8_t value);
+} z80_t;
+
+
+void z80_reset(z80_t* cpu);
+
+/**
+ * @brief Execute a single instruction (prefixes included).
+ *
+ * @returns the number of T-states the instruction took.
+ */
+int z80_step(z80_t* cpu);
+
+/**
+ * @brief Helpers to access the stack, used by the hosts that trap calls (syscalls).
+ */
+void z80_push(z80_t* cpu, uint16_t value);
+uint16_t z80_pop(z80_t* cpu);
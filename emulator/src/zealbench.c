@@ -0,0 +1,638 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "zos.h"
+
+/**
+ * Cycle benchmark of gbdump.bin: run the program against a set of synthetic cartridges with a
+ * scripted host and print a table of T-states. The emulation is deterministic, so two runs of the
+ * same binary give the same table, which can be compared between commits.
+ */
+
+#define DEFAULT_BAUDRATE    57600
+#define MAX_CYCLES          4000000000ULL
+#define ROM_SIZE            (64*1024)
+#define USAGE               "usage: %s [-p symbols.cdb] [-b baudrate] [-f faults] [-c rate] [-d design] [-R romdisk] program.bin\n"
+
+typedef struct {
+    const char* name;
+    uint8_t     type;
+    uint8_t     ram_size;
+} scenario_t;
+
+/**
+ * Session of the scripted host: fills `script` with the bytes sent to the program for the given
+ * cartridge, at most `script_size(cart)` bytes, and returns their number. The host doesn't read the
+ * replies, so the script must be the exact sequence the program expects from the cartridge content.
+ */
+typedef uint32_t (*session_script_t)(const cart_t* cart, uint8_t* script);
+
+typedef struct {
+    const char*      name;
+    session_script_t script;
+} session_t;
+
+typedef struct {
+    bool     ok;
+    uint64_t sent;
+    /* Bytes sent and received by the program after the command */
+    uint64_t bytes;
+    uint64_t cycles;
+    uint64_t session_cycles;
+    uint64_t wire_cycles;
+    uint32_t contact_flips;
+    profile_func_t funcs[PROFILE_MAX_FUNCS];
+} result_t;
+
+static const scenario_t s_scenarios[] = {
+    { "MBC1 32KB",  0x03, 3 },
+    { "MBC2 512B",  0x06, 0 },
+    { "MBC3 32KB",  0x13, 3 },
+    { "MBC3T 32KB", 0x10, 3 },
+    { "MBC5 128KB", 0x1b, 4 },
+    { "MBC7 256B",  0x22, 0 },
+    { "Camera 128KB", 0xfc, 4 },
+};
+#define SCENARIO_COUNT  ((int) (sizeof(s_scenarios) / sizeof(s_scenarios[0])))
+
+/* Protocol constants, must match software/src/protocol.h */
+#define CMD_DUMP            '!'
+#define CMD_RESTORE_PACKED  'Z'
+#define CMD_RESTORE_DELTA   'D'
+#define CMD_ROM             'O'
+#define CMD_SEARCH          'S'
+#define CMD_QUIT            'Q'
+#define PACK_RAW            0
+#define PACK_RLE            1
+#define PACK_LZ             2
+#define PACK_END            0xff
+#define DELTA_BLOCK_SIZE    256
+#define DELTA_READ          0x80
+#define DELTA_END           0xff
+#define SEARCH_ROM          0
+#define SEARCH_PATTERN_MAX  16
+
+/* Decoded size of the compressed frames, small enough for any frame to fit in the frame buffer of
+ * the program (1024 bytes), even when the data doesn't compress */
+#define PACK_CHUNK_SIZE     512
+/* Same limits as the encoders of gbcodec.py */
+#define RLE_MAX_LITERALS    128
+#define RLE_MAX_RUN         129
+#define LZ_MIN_MATCH        3
+#define LZ_MAX_MATCH        18
+
+static uint32_t script_dump(const cart_t* cart, uint8_t* script);
+static uint32_t script_rom(const cart_t* cart, uint8_t* script);
+static uint32_t script_packed(const cart_t* cart, uint8_t* script);
+static uint32_t script_delta(const cart_t* cart, uint8_t* script);
+static uint32_t script_search(const cart_t* cart, uint8_t* script);
+
+static const session_t s_sessions[] = {
+    { "SRAM dump",      script_dump },
+    { "ROM dump",       script_rom },
+    { "Packed restore", script_packed },
+    { "Delta restore",  script_delta },
+    { "ROM search",     script_search },
+};
+#define SESSION_COUNT   ((int) (sizeof(s_sessions) / sizeof(s_sessions[0])))
+
+static result_t s_results[SESSION_COUNT][SCENARIO_COUNT];
+
+
+/**
+ * @brief Build a cartridge with a valid header and pseudo-random SRAM content
+ */
+static int make_cart(cart_t* cart, const scenario_t* scenario)
+{
+    static uint8_t rom[ROM_SIZE];
+    uint32_t seed = 0x12345678;
+
+    for (uint32_t i = 0; i < ROM_SIZE; i++) {
+        rom[i] = i / CART_ROM_BANK_SIZE;
+    }
+    memset(rom + CART_HDR_TITLE, 0, 16);
+    strncpy((char*) rom + CART_HDR_TITLE, scenario->name, 15);
+    rom[CART_HDR_TYPE] = scenario->type;
+    rom[CART_HDR_ROM_SIZE] = 1;
+    rom[CART_HDR_RAM_SIZE] = scenario->ram_size;
+
+    if (cart_init(cart, rom, ROM_SIZE) != 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < cart->ram_size; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        cart->ram[i] = seed;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Size and number of the SRAM banks, as computed by the program
+ */
+static void sram_banks(const cart_t* cart, uint32_t* bank_size, uint32_t* banks)
+{
+    *bank_size = cart->ram_size < CART_RAM_BANK_SIZE ? cart->ram_size : CART_RAM_BANK_SIZE;
+    *banks = *bank_size == 0 ? 0 : cart->ram_size / *bank_size;
+}
+
+
+/**
+ * @brief Maximum size of a session script: the restores send the SRAM content with a few bytes of
+ *        header per frame or block, a frame can be slightly bigger than its decoded content
+ */
+static uint32_t script_size(const cart_t* cart)
+{
+    return 2 * cart->ram_size + 1024;
+}
+
+
+static void put_u16(uint8_t* out, uint16_t value)
+{
+    out[0] = value;
+    out[1] = value >> 8;
+}
+
+
+static void put_u32(uint8_t* out, uint32_t value)
+{
+    put_u16(out, value);
+    put_u16(out + 2, value >> 16);
+}
+
+
+/**
+ * @brief Same hash as hash_block in software/src/hash.c
+ */
+static uint32_t block_hash(const uint8_t* data, uint32_t len)
+{
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+
+    for (uint32_t i = 0; i < len; i++) {
+        sum1 += data[i];
+        sum2 += sum1;
+    }
+    return ((uint32_t) sum2 << 16) | sum1;
+}
+
+
+/**
+ * @brief Build the save restored by the sessions: the 256-byte blocks are, in turn, erased, a table
+ *        of records, runs of a few values and random bytes. The upper nibbles of MBC2 read as 1s,
+ *        they are set so that the save reads back as sent.
+ */
+static void make_save(const cart_t* cart, uint8_t* save)
+{
+    static const uint8_t run_values[] = { 0x00, 0x01, 0xff };
+    uint32_t seed = 0x9abcdef0;
+
+    for (uint32_t i = 0; i < cart->ram_size; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        switch ((i / DELTA_BLOCK_SIZE) % 4) {
+            case 0: save[i] = 0xff; break;
+            /* 16-byte records that only differ by their first byte */
+            case 1: save[i] = i % 16 == 0 ? i / 16 : (i % 16) * 0x11; break;
+            case 2: save[i] = i % 16 == 0 ? run_values[seed % 3] : save[i - 1]; break;
+            default: save[i] = seed; break;
+        }
+        if (cart->mbc == CART_MBC2) {
+            save[i] |= 0xf0;
+        }
+    }
+}
+
+
+static uint32_t rle_literals(uint8_t* out, const uint8_t* literals, uint32_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    out[0] = count - 1;
+    memcpy(out + 1, literals, count);
+    return 1 + count;
+}
+
+
+/**
+ * @brief Same encoding as rle_encode in gbcodec.py
+ */
+static uint32_t rle_encode(const uint8_t* data, uint32_t len, uint8_t* out)
+{
+    uint32_t size = 0;
+    uint32_t literals = 0;
+    uint32_t i = 0;
+
+    while (i < len) {
+        uint32_t run = 1;
+        while (i + run < len && run < RLE_MAX_RUN && data[i + run] == data[i]) {
+            run++;
+        }
+        if (run >= 2) {
+            size += rle_literals(out + size, data + i - literals, literals);
+            literals = 0;
+            out[size++] = 0x80 + run - 2;
+            out[size++] = data[i];
+            i += run;
+        } else {
+            literals++;
+            i++;
+            if (literals == RLE_MAX_LITERALS) {
+                size += rle_literals(out + size, data + i - literals, literals);
+                literals = 0;
+            }
+        }
+    }
+    return size + rle_literals(out + size, data + i - literals, literals);
+}
+
+
+/**
+ * @brief Same format as lz_encode in gbcodec.py, the longest match is looked for at every offset,
+ *        `len` must not be bigger than the maximum offset (4095)
+ */
+static uint32_t lz_encode(const uint8_t* data, uint32_t len, uint8_t* out)
+{
+    uint32_t size = 0;
+    uint32_t flags = 0;
+    uint32_t item = 8;
+    uint32_t i = 0;
+
+    while (i < len) {
+        if (item == 8) {
+            flags = size++;
+            out[flags] = 0;
+            item = 0;
+        }
+        uint32_t best_len = 0;
+        uint32_t best_off = 0;
+        for (uint32_t off = 1; off <= i && best_len < LZ_MAX_MATCH; off++) {
+            uint32_t length = 0;
+            while (length < LZ_MAX_MATCH && i + length < len && data[i - off + length] == data[i + length]) {
+                length++;
+            }
+            if (length > best_len) {
+                best_len = length;
+                best_off = off;
+            }
+        }
+        if (best_len >= LZ_MIN_MATCH) {
+            out[flags] |= 1 << item;
+            out[size++] = best_off;
+            out[size++] = ((best_off >> 8) << 4) | (best_len - LZ_MIN_MATCH);
+            i += best_len;
+        } else {
+            out[size++] = data[i++];
+        }
+        item++;
+    }
+    return size;
+}
+
+
+static uint32_t script_dump(const cart_t* cart, uint8_t* script)
+{
+    (void) cart;
+    script[0] = CMD_DUMP;
+    return 1;
+}
+
+
+static uint32_t script_rom(const cart_t* cart, uint8_t* script)
+{
+    (void) cart;
+    script[0] = CMD_ROM;
+    return 1;
+}
+
+
+/**
+ * @brief Restore the whole save as frames of PACK_CHUNK_SIZE decoded bytes. The frames alternate
+ *        between RLE and LZ, so that both decoders are measured, a frame that doesn't compress is
+ *        sent raw.
+ */
+static uint32_t script_packed(const cart_t* cart, uint8_t* script)
+{
+    uint8_t* save = malloc(cart->ram_size);
+    uint32_t bank_size;
+    uint32_t banks;
+    uint32_t size = 0;
+
+    if (save == NULL) {
+        return 0;
+    }
+    make_save(cart, save);
+    sram_banks(cart, &bank_size, &banks);
+    script[size++] = CMD_RESTORE_PACKED;
+    for (uint32_t bank = 0; bank < banks; bank++) {
+        const uint8_t* content = save + bank * bank_size;
+        for (uint32_t offset = 0; offset < bank_size; offset += PACK_CHUNK_SIZE) {
+            const uint32_t chunk = bank_size - offset < PACK_CHUNK_SIZE ? bank_size - offset : PACK_CHUNK_SIZE;
+            uint8_t* frame = script + size;
+            uint8_t kind = (bank + offset / PACK_CHUNK_SIZE) % 2 ? PACK_LZ : PACK_RLE;
+            uint32_t packed = kind == PACK_RLE ? rle_encode(content + offset, chunk, frame + 5) :
+                                                 lz_encode(content + offset, chunk, frame + 5);
+            if (packed >= chunk) {
+                kind = PACK_RAW;
+                packed = chunk;
+                memcpy(frame + 5, content + offset, chunk);
+            }
+            frame[0] = kind;
+            put_u16(frame + 1, packed);
+            put_u16(frame + 3, chunk);
+            size += 5 + packed;
+        }
+        /* The end frame gives the hash the bank is checked against */
+        script[size++] = PACK_END;
+        put_u32(script + size, block_hash(content, bank_size));
+        size += 4;
+    }
+    free(save);
+    return size;
+}
+
+
+/**
+ * @brief Restore one block out of three of the save, so that all the kinds of blocks are sent, then
+ *        read back the first block, as a two-way synchronisation does
+ */
+static uint32_t script_delta(const cart_t* cart, uint8_t* script)
+{
+    uint8_t* save = malloc(cart->ram_size);
+    uint32_t bank_size;
+    uint32_t banks;
+    uint32_t size = 0;
+
+    if (save == NULL) {
+        return 0;
+    }
+    make_save(cart, save);
+    sram_banks(cart, &bank_size, &banks);
+    script[size++] = CMD_RESTORE_DELTA;
+    for (uint32_t bank = 0; bank < banks; bank++) {
+        for (uint32_t block = 0; block < bank_size / DELTA_BLOCK_SIZE; block += 3) {
+            const uint8_t* content = save + bank * bank_size + block * DELTA_BLOCK_SIZE;
+            script[size++] = bank;
+            script[size++] = block;
+            put_u32(script + size, block_hash(content, DELTA_BLOCK_SIZE));
+            size += 4;
+            memcpy(script + size, content, DELTA_BLOCK_SIZE);
+            size += DELTA_BLOCK_SIZE;
+        }
+    }
+    memset(script + size, 0, 12);
+    script[size] = DELTA_READ;
+    script[size + 6] = DELTA_END;
+    size += 12;
+    free(save);
+    return size;
+}
+
+
+/**
+ * @brief Fixed-size record of a pattern, see CMD_SEARCH in software/src/protocol.h
+ */
+static uint32_t search_record(uint8_t* record, const uint8_t* bytes, const uint8_t* mask, uint8_t len)
+{
+    record[0] = len;
+    memset(record + 1, 0, 2 * SEARCH_PATTERN_MAX);
+    memcpy(record + 1, bytes, len);
+    memcpy(record + 1 + SEARCH_PATTERN_MAX, mask, len);
+    return 1 + 2 * SEARCH_PATTERN_MAX;
+}
+
+
+/**
+ * @brief Search the ROM for three patterns, one for each path of the search: the start of the title,
+ *        found once in the header, a masked byte followed by 0x01, whose anchor is found at each byte
+ *        of the bank 1 without any match, and a pattern without any full mask, compared at each
+ *        position
+ */
+static uint32_t script_search(const cart_t* cart, uint8_t* script)
+{
+    static const uint8_t full[] = { 0xff, 0xff, 0xff, 0xff };
+    static const uint8_t anchored[] = { 0x00, 0x01 };
+    static const uint8_t anchored_mask[] = { 0x0f, 0xff };
+    static const uint8_t loose[] = { 0x50, 0x50 };
+    static const uint8_t loose_mask[] = { 0xf0, 0xf0 };
+    uint32_t size = 0;
+
+    script[size++] = CMD_SEARCH;
+    script[size++] = SEARCH_ROM;
+    script[size++] = 3;
+    size += search_record(script + size, cart->rom + CART_HDR_TITLE, full, sizeof(full));
+    size += search_record(script + size, anchored, anchored_mask, sizeof(anchored));
+    size += search_record(script + size, loose, loose_mask, sizeof(loose));
+    return size;
+}
+
+
+static int run_scenario(const char* program, const scenario_t* scenario, const session_t* session,
+                        profile_t* prof, uint32_t baudrate, const link_config_t* faults, double contact,
+                        const char* design, const char* romdisk, result_t* result)
+{
+    cart_t cart;
+    serial_t serial;
+    link_t faulty_link;
+    zos_t zos;
+    uint8_t* script;
+    uint32_t script_len = 0;
+    FILE* console;
+
+    if (make_cart(&cart, scenario) != 0) {
+        return -1;
+    }
+    script = malloc(script_size(&cart) + 1);
+    if (script != NULL) {
+        script_len = session->script(&cart, script);
+    }
+    if (script_len == 0) {
+        free(script);
+        cart_free(&cart);
+        return -1;
+    }
+    /* When the program rejects the command, it waits for the next one: make it exit */
+    script[script_len++] = CMD_QUIT;
+    cart_set_contact_faults(&cart, contact, 42);
+    serial_open_script(&serial, script, script_len, baudrate);
+    if (zos_init(&zos, program, &cart, &serial) != 0) {
+        free(script);
+        cart_free(&cart);
+        return -1;
+    }
+    console = fopen("/dev/null", "w");
+    zos.console = console ? console : stdout;
+    zos.romdisk = romdisk;
+    if (design != NULL && zos_set_decode(&zos, design) != 0) {
+        fprintf(stderr, "Unknown PLD design %s\n", design);
+        zos_free(&zos);
+        cart_free(&cart);
+        return -1;
+    }
+    if (faults != NULL) {
+        link_init(&faulty_link, faults);
+        serial.link = &faulty_link;
+    }
+    if (prof != NULL) {
+        profile_reset(prof);
+        zos.profile = prof;
+    }
+
+    result->ok = zos_run(&zos, MAX_CYCLES) == 0;
+    result->sent = serial.tx_bytes;
+    result->cycles = zos.cpu.cycles;
+    result->contact_flips = cart.contact_flips;
+    if (zos.first_rx_cycles != 0) {
+        /* The command itself was received before the session started */
+        result->bytes = serial.tx_bytes + serial.rx_bytes - 1;
+        result->session_cycles = zos.cpu.cycles - zos.first_rx_cycles;
+        result->wire_cycles = zos.serial_cycles - serial_cycles(&serial, 1, ZOS_CPU_FREQ);
+    }
+    if (prof != NULL) {
+        memcpy(result->funcs, prof->funcs, sizeof(result->funcs));
+    }
+
+    zos_free(&zos);
+    cart_free(&cart);
+    free(script);
+    if (console) {
+        fclose(console);
+    }
+    return 0;
+}
+
+
+static void print_ratio(uint64_t value, uint64_t count)
+{
+    if (count == 0) {
+        printf(" %12s", "-");
+    } else {
+        printf(" %12.1f", (double) value / count);
+    }
+}
+
+
+/**
+ * @brief Print the results of a session: T-states from the host command to the exit, per byte
+ *        exchanged with the host. The overhead column removes the time spent on the wire, which only
+ *        depends on the baudrate. With the profiler, T-states per call of each function called.
+ */
+static void print_session(int s, const profile_t* prof, double contact)
+{
+    const result_t* results = s_results[s];
+
+    printf("\n%s\n", s_sessions[s].name);
+    printf("%-12s %8s %12s %12s %12s%s\n", "Scenario", "Bytes", "T-states", "T/B", "Overhead T/B",
+           contact > 0 ? "   Bad reads" : "");
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        const result_t* res = &results[i];
+        printf("%-12s %8llu %12llu", s_scenarios[i].name, (unsigned long long) res->bytes,
+               (unsigned long long) res->cycles);
+        print_ratio(res->session_cycles, res->bytes);
+        print_ratio(res->session_cycles - res->wire_cycles, res->bytes);
+        /* With a flaky contact, number of cartridge reads that got corrupted */
+        if (contact > 0) {
+            printf(" %11u", res->contact_flips);
+        }
+        /* Specialised binaries exit without sending anything for the other cartridge types, a command
+         * the cartridge doesn't support only gets an error reply */
+        printf("%s\n", !res->ok ? "  (failed)" : res->sent <= 2 ? "  (not supported)" : "");
+    }
+
+    if (prof == NULL) {
+        return;
+    }
+
+    /* Per function: inclusive T-states per call, syscalls included */
+    printf("\n%-24s", "T-states per call");
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        printf(" %12s", s_scenarios[i].name);
+    }
+    printf("\n");
+    for (int f = 0; f < prof->count; f++) {
+        bool called = false;
+        for (int i = 0; i < SCENARIO_COUNT; i++) {
+            called |= results[i].funcs[f].calls != 0;
+        }
+        if (!called) {
+            continue;
+        }
+        printf("%-24s", prof->funcs[f].name);
+        for (int i = 0; i < SCENARIO_COUNT; i++) {
+            print_ratio(results[i].funcs[f].cycles, results[i].funcs[f].calls);
+        }
+        printf("\n");
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* symbols = NULL;
+    const char* design = NULL;
+    const char* romdisk = NULL;
+    uint32_t baudrate = DEFAULT_BAUDRATE;
+    link_config_t faults;
+    bool has_faults = false;
+    double contact = 0;
+    profile_t* prof = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:b:f:c:d:R:h")) != -1) {
+        switch (opt) {
+            case 'p': symbols = optarg; break;
+            case 'b': baudrate = strtoul(optarg, NULL, 0); break;
+            case 'c': contact = strtod(optarg, NULL); break;
+            case 'd': design = optarg; break;
+            case 'R': romdisk = optarg; break;
+            case 'f':
+                if (link_parse(&faults, optarg) != 0) {
+                    fprintf(stderr, "Invalid fault specification: %s\n", optarg);
+                    return 1;
+                }
+                has_faults = true;
+                break;
+            default:
+                fprintf(stderr, USAGE, argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1 || baudrate == 0) {
+        fprintf(stderr, USAGE, argv[0]);
+        return 1;
+    }
+
+    if (symbols != NULL) {
+        prof = malloc(sizeof(profile_t));
+        if (prof == NULL || profile_load(prof, symbols) <= 0) {
+            return 1;
+        }
+    }
+
+    for (int s = 0; s < SESSION_COUNT; s++) {
+        for (int i = 0; i < SCENARIO_COUNT; i++) {
+            if (run_scenario(argv[optind], &s_scenarios[i], &s_sessions[s], prof, baudrate,
+                             has_faults ? &faults : NULL, contact, design, romdisk, &s_results[s][i]) != 0) {
+                return 1;
+            }
+        }
+    }
+
+    printf("%s, Z80 at %d MHz, UART at %u baud\n", argv[optind], ZOS_CPU_FREQ / 1000000, baudrate);
+    for (int s = 0; s < SESSION_COUNT; s++) {
+        print_session(s, prof, contact);
+    }
+
+    free(prof);
+    return 0;
+}
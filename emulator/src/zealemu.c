@@ -0,0 +1,153 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "zos.h"
+
+#define DEFAULT_BAUDRATE    57600
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-r rom.gb] [-s save.sav] [-o out.sav] [-l link] [-b baudrate]\n"
+            "          [-t timeout_ms] [-m max_tstates] [-f faults] [-c rate] [-d design] [-R romdisk] [-q]\n"
+            "          program.bin\n"
+            "  -r  ROM image of the cartridge inserted in the adapter\n"
+            "  -s  SRAM image loaded in the cartridge before running\n"
+            "  -o  file to save the cartridge SRAM to, after the program exits\n"
+            "  -l  symbolic link to create to the #SER0 pseudo-terminal\n"
+            "  -b  baudrate of the emulated UART, used to count T-states (default %d)\n"
+            "  -t  stop waiting for the host after this many milliseconds of silence\n"
+            "  -m  stop the emulation after this many T-states\n"
+            "  -f  inject faults on the serial link, for example flip=1e-4,drop=1e-5,dup=1e-5,\n"
+            "      stall=1e-4:200 (probability:milliseconds), baud=3.5 (percent), dir=tx|rx|both, seed=42\n"
+            "  -c  flaky cartridge contact: probability for a cartridge read to get a bit flipped\n"
+            "  -d  CUPL name of the PLD design programmed in the adapter (default ZealGBCDumper)\n"
+            "  -R  host directory whose files are visible to the program in A:/\n"
+            "  -q  don't print the statistics at exit\n",
+            name, DEFAULT_BAUDRATE);
+}
+
+
+int main(int argc, char** argv)
+{
+    const char* rom_path = NULL;
+    const char* sram_path = NULL;
+    const char* out_path = NULL;
+    const char* link = NULL;
+    uint32_t baudrate = DEFAULT_BAUDRATE;
+    int timeout_ms = -1;
+    uint64_t max_cycles = 0;
+    int quiet = 0;
+    const char* faults = NULL;
+    double contact = 0;
+    const char* design = NULL;
+    const char* romdisk = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:s:o:l:b:t:m:f:c:d:R:qh")) != -1) {
+        switch (opt) {
+            case 'r': rom_path = optarg; break;
+            case 's': sram_path = optarg; break;
+            case 'o': out_path = optarg; break;
+            case 'l': link = optarg; break;
+            case 'b': baudrate = strtoul(optarg, NULL, 0); break;
+            case 't': timeout_ms = atoi(optarg); break;
+            case 'm': max_cycles = strtoull(optarg, NULL, 0); break;
+            case 'f': faults = optarg; break;
+            case 'c': contact = strtod(optarg, NULL); break;
+            case 'd': design = optarg; break;
+            case 'R': romdisk = optarg; break;
+            case 'q': quiet = 1; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1 || baudrate == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    cart_t cart;
+    cart_t* cart_ptr = NULL;
+    if (rom_path != NULL) {
+        if (cart_load(&cart, rom_path, sram_path) != 0) {
+            return 1;
+        }
+        cart_ptr = &cart;
+        cart_set_contact_faults(&cart, contact, 42);
+        fprintf(stderr, "Cartridge: %s, %u KB ROM, %u bytes RAM\n", cart_mbc_name(&cart),
+                cart.rom_size / 1024, cart.ram_size);
+    }
+
+    serial_t serial;
+    if (serial_open(&serial, link, baudrate) != 0) {
+        return 1;
+    }
+    fprintf(stderr, "#SER0 is %s%s%s\n", serial.path, link ? ", linked as " : "", link ? link : "");
+
+    link_t faulty_link;
+    if (faults != NULL) {
+        link_config_t config;
+        if (link_parse(&config, faults) != 0) {
+            fprintf(stderr, "Invalid fault specification: %s\n", faults);
+            serial_close(&serial);
+            return 1;
+        }
+        link_init(&faulty_link, &config);
+        serial.link = &faulty_link;
+    }
+
+    zos_t zos;
+    if (zos_init(&zos, argv[optind], cart_ptr, &serial) != 0) {
+        serial_close(&serial);
+        return 1;
+    }
+    zos.serial_timeout_ms = timeout_ms;
+    zos.romdisk = romdisk;
+    if (design != NULL && zos_set_decode(&zos, design) != 0) {
+        fprintf(stderr, "Unknown PLD design %s\n", design);
+        zos_free(&zos);
+        serial_close(&serial);
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const int err = zos_run(&zos, max_cycles);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (!quiet) {
+        const double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        const double simulated = (double) zos.cpu.cycles / ZOS_CPU_FREQ;
+        zos_print_stats(&zos, stderr);
+        if (serial.link != NULL) {
+            link_print_stats(serial.link, stderr);
+        }
+        if (cart_ptr != NULL && contact > 0) {
+            fprintf(stderr, "Cartridge contact: %u reads corrupted\n", cart.contact_flips);
+        }
+        /* Throughput of the Zeal side, over the simulated and the real duration of the session
+         * (the latter includes the host waits). The goodput is measured on the host side. */
+        fprintf(stderr, "Throughput: %.0f B/s simulated, %.0f B/s wall-clock (%.3f s)\n",
+                simulated > 0 ? serial.tx_bytes / simulated : 0.0,
+                wall > 0 ? serial.tx_bytes / wall : 0.0, wall);
+    }
+    if (cart_ptr != NULL && out_path != NULL && cart_save_sram(cart_ptr, out_path) != 0) {
+        fprintf(stderr, "Could not save the SRAM to %s\n", out_path);
+    }
+
+    zos_free(&zos);
+    serial_close(&serial);
+    if (cart_ptr != NULL) {
+        cart_free(cart_ptr);
+    }
+    return err == 0 ? zos.exit_code : 2;
+}
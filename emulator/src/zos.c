@@ -0,0 +1,636 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "zos.h"
+#include "pld_decode.h"
+
+/* Longest path accepted by `open` */
+#define ZOS_PATH_MAX    64
+
+/**
+ * Rough cost of each syscall inside the kernel, in T-states, not counting the data transfer
+ * itself. These are estimates that make the statistics comparable between two runs,
+ * not measurements of the real kernel.
+ */
+static const uint16_t s_syscall_overhead[ZOS_SYS_COUNT] = {
+    [ZOS_SYS_READ]  = 250,
+    [ZOS_SYS_WRITE] = 250,
+    [ZOS_SYS_OPEN]  = 1500,
+    [ZOS_SYS_CLOSE] = 300,
+    [ZOS_SYS_IOCTL] = 200,
+    [ZOS_SYS_EXIT]  = 0,
+    [ZOS_SYS_OPENDIR] = 1500,
+    [ZOS_SYS_READDIR] = 400,
+    [ZOS_SYS_MAP]   = 150,
+    [ZOS_SYS_GETTIME] = 200,
+};
+
+/* Reading a file from the romdisk costs a copy from the flash, `ldir` takes 21 T-states per byte */
+#define ZOS_ROMDISK_CYCLES_PER_BYTE 21
+
+static const char* s_syscall_names[ZOS_SYS_COUNT] = {
+    "read", "write", "open", "close", "dstat", "stat", "seek", "ioctl", "mkdir",
+    "getdir", "chdir", "opendir", "readdir", "rm", "mount", "exit", "exec", "dup",
+    "msleep", "settime", "gettime", "setdate", "getdate", "map", "swap", "palloc", "pfree"
+};
+
+
+/**
+ * @brief Access to a physical address outside of the RAM, decoded by the adapter PLD. The table is
+ *        generated from the CUPL sources by pld/pldsim.py: it gives, for each 8KB granule, the chip
+ *        selected and the address lines A13-A15 the cartridge sees. The MBC only decodes its SRAM
+ *        when /CS is asserted and A14 is low, at 0xA000-0xBFFF from the cartridge point of view.
+ *
+ * @returns the address to pass to the cartridge model, or -1 if nothing answers.
+ */
+static inline int32_t cart_bus_addr(const zos_t* zos, uint32_t phys)
+{
+    if (zos->cart == NULL || phys >= ZOS_PHYS_MAX) {
+        return -1;
+    }
+    const pld_entry_t* entry = &zos->decode[phys >> PLD_GRANULE_BITS];
+    const uint16_t low = phys & ((1 << PLD_GRANULE_BITS) - 1);
+
+    if (entry->sel == PLD_SEL_ROM) {
+        return entry->cart_addr | low;
+    }
+    if (entry->sel == PLD_SEL_SRAM && (entry->cart_addr & 0x4000) == 0) {
+        return 0xa000 | low;
+    }
+    return -1;
+}
+
+
+static uint8_t mem_read(void* ctx, uint16_t addr)
+{
+    zos_t* zos = (zos_t*) ctx;
+    const uint32_t phys = zos->page_phys[addr >> 14] + (addr & 0x3fff);
+
+    if (phys - ZOS_PHYS_RAM < ZOS_PHYS_RAM_SIZE) {
+        return zos->ram[phys - ZOS_PHYS_RAM];
+    }
+    const int32_t cart_addr = cart_bus_addr(zos, phys);
+    if (cart_addr >= 0) {
+        return cart_read(zos->cart, cart_addr);
+    }
+    /* Kernel ROM or unmapped physical memory */
+    return 0xff;
+}
+
+
+static void mem_write(void* ctx, uint16_t addr, uint8_t value)
+{
+    zos_t* zos = (zos_t*) ctx;
+    const uint32_t phys = zos->page_phys[addr >> 14] + (addr & 0x3fff);
+
+    if (phys - ZOS_PHYS_RAM < ZOS_PHYS_RAM_SIZE) {
+        zos->ram[phys - ZOS_PHYS_RAM] = value;
+        return;
+    }
+    const int32_t cart_addr = cart_bus_addr(zos, phys);
+    if (cart_addr >= 0) {
+        cart_write(zos->cart, cart_addr, value);
+    }
+}
+
+
+static uint8_t io_read(void* ctx, uint16_t port)
+{
+    (void) ctx;
+    (void) port;
+    return 0xff;
+}
+
+
+static void io_write(void* ctx, uint16_t port, uint8_t value)
+{
+    (void) ctx;
+    (void) port;
+    (void) value;
+}
+
+
+int zos_init(zos_t* zos, const char* program, cart_t* cart, serial_t* serial)
+{
+    memset(zos, 0, sizeof(zos_t));
+    zos->cart = cart;
+    zos->serial = serial;
+    zos->console = stdout;
+    zos->serial_timeout_ms = -1;
+    zos->serial_read_timeout = ZOS_SERIAL_TIMEOUT_NONE;
+    zos->devs[ZOS_DEV_STDOUT] = ZOS_DEV_CONSOLE;
+    zos->devs[ZOS_DEV_STDIN] = ZOS_DEV_CONSOLE;
+    zos->decode = pld_designs[0].decode;
+
+    zos->ram = calloc(1, ZOS_PHYS_RAM_SIZE);
+    if (zos->ram == NULL) {
+        return -1;
+    }
+
+    /* The kernel is in the first page, the program and its stack in the three others */
+    zos->page_phys[0] = 0;
+    for (int i = 1; i < 4; i++) {
+        zos->page_phys[i] = ZOS_PHYS_RAM + i * ZOS_PAGE_SIZE;
+    }
+
+    FILE* file = fopen(program, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open program %s\n", program);
+        return -1;
+    }
+    uint8_t* dest = zos->ram + zos->page_phys[1] - ZOS_PHYS_RAM;
+    const size_t size = fread(dest, 1, ZOS_PAGE_SIZE + 1, file);
+    fclose(file);
+    if (size == 0 || size > ZOS_PAGE_SIZE) {
+        fprintf(stderr, "Program %s must be between 1 byte and 16KB big\n", program);
+        return -1;
+    }
+
+    z80_t* cpu = &zos->cpu;
+    cpu->ctx = zos;
+    cpu->read = mem_read;
+    cpu->write = mem_write;
+    cpu->in = io_read;
+    cpu->out = io_write;
+    z80_reset(cpu);
+    cpu->pc = ZOS_PROGRAM_ADDR;
+    cpu->sp = 0;
+    return 0;
+}
+
+
+int zos_set_decode(zos_t* zos, const char* design)
+{
+    for (const pld_design_t* entry = pld_designs; entry->name != NULL; entry++) {
+        if (strcmp(entry->name, design) == 0) {
+            zos->decode = entry->decode;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+
+void zos_free(zos_t* zos)
+{
+    /* Files and directories the program didn't close */
+    for (int i = 0; i < ZOS_MAX_OPENED_DEV; i++) {
+        if (zos->devs[i] == ZOS_DEV_FILE) {
+            fclose(zos->files[i]);
+        } else if (zos->devs[i] == ZOS_DEV_DIR) {
+            closedir(zos->dirs[i]);
+        }
+        zos->devs[i] = ZOS_DEV_NONE;
+    }
+    free(zos->ram);
+    zos->ram = NULL;
+}
+
+
+/**
+ * Helpers to transfer buffers between the program virtual memory and the host
+ */
+static void copy_from_virt(zos_t* zos, uint16_t addr, uint8_t* dst, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        dst[i] = mem_read(zos, addr + i);
+    }
+}
+
+static void copy_to_virt(zos_t* zos, uint16_t addr, const uint8_t* src, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        mem_write(zos, addr + i, src[i]);
+    }
+}
+
+
+static int alloc_dev(zos_t* zos, zos_dev_kind_t kind)
+{
+    for (int i = 0; i < ZOS_MAX_OPENED_DEV; i++) {
+        if (zos->devs[i] == ZOS_DEV_NONE) {
+            zos->devs[i] = kind;
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+static void read_path(zos_t* zos, char* name)
+{
+    z80_t* cpu = &zos->cpu;
+
+    memset(name, 0, ZOS_PATH_MAX + 1);
+    for (int i = 0; i < ZOS_PATH_MAX; i++) {
+        name[i] = mem_read(zos, cpu->bc.w + i);
+        if (name[i] == 0) {
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief Convert a path of the romdisk into a host path, returns false if the path is not on it.
+ */
+static bool romdisk_path(const zos_t* zos, const char* name, char* host, size_t size)
+{
+    const size_t prefix = strlen(ZOS_ROMDISK_PREFIX);
+
+    if (zos->romdisk == NULL || strncmp(name, ZOS_ROMDISK_PREFIX, prefix) != 0 ||
+        strstr(name, "..") != NULL) {
+        return false;
+    }
+    snprintf(host, size, "%s/%s", zos->romdisk, name + prefix);
+    return true;
+}
+
+
+static uint8_t sys_open(zos_t* zos)
+{
+    z80_t* cpu = &zos->cpu;
+    char name[ZOS_PATH_MAX + 1];
+    char host[4096];
+
+    read_path(zos, name);
+
+    if (strcmp(name, "#SER0") == 0 && zos->serial != NULL) {
+        const int dev = alloc_dev(zos, ZOS_DEV_SERIAL);
+        return dev < 0 ? (uint8_t) -ZOS_ERR_CANNOT_REGISTER : dev;
+    }
+    if (romdisk_path(zos, name, host, sizeof(host))) {
+        if (cpu->hl.b.h != ZOS_O_RDONLY) {
+            return (uint8_t) -ZOS_ERR_READ_ONLY;
+        }
+        FILE* file = fopen(host, "rb");
+        if (file == NULL) {
+            return (uint8_t) -ZOS_ERR_NO_SUCH_ENTRY;
+        }
+        const int dev = alloc_dev(zos, ZOS_DEV_FILE);
+        if (dev < 0) {
+            fclose(file);
+            return (uint8_t) -ZOS_ERR_CANNOT_REGISTER;
+        }
+        zos->files[dev] = file;
+        return dev;
+    }
+    return (uint8_t) -ZOS_ERR_NO_SUCH_ENTRY;
+}
+
+
+static uint8_t sys_opendir(zos_t* zos)
+{
+    char name[ZOS_PATH_MAX + 1];
+    char host[4096];
+
+    read_path(zos, name);
+    if (!romdisk_path(zos, name, host, sizeof(host))) {
+        return (uint8_t) -ZOS_ERR_NO_SUCH_ENTRY;
+    }
+    DIR* dir = opendir(host);
+    if (dir == NULL) {
+        return (uint8_t) -ZOS_ERR_NO_SUCH_ENTRY;
+    }
+    const int dev = alloc_dev(zos, ZOS_DEV_DIR);
+    if (dev < 0) {
+        closedir(dir);
+        return (uint8_t) -ZOS_ERR_CANNOT_REGISTER;
+    }
+    zos->dirs[dev] = dir;
+    return dev;
+}
+
+
+/**
+ * @brief Fill the zos_dir_entry_t at DE: flags byte followed by the name, not terminated if it is
+ *        ZOS_FILENAME_LEN_MAX long. The host entries that don't fit are skipped.
+ */
+static uint8_t sys_readdir(zos_t* zos)
+{
+    z80_t* cpu = &zos->cpu;
+    const uint8_t dev = cpu->hl.b.h;
+    struct dirent* entry;
+
+    if (dev >= ZOS_MAX_OPENED_DEV || zos->devs[dev] != ZOS_DEV_DIR) {
+        return ZOS_ERR_INVALID_DEV;
+    }
+    while ((entry = readdir(zos->dirs[dev])) != NULL) {
+        const size_t len = strlen(entry->d_name);
+        if (entry->d_name[0] != '.' && len <= ZOS_FILENAME_LEN_MAX) {
+            uint8_t raw[1 + ZOS_FILENAME_LEN_MAX] = { entry->d_type == DT_DIR ? 0 : ZOS_D_ISFILE };
+            memcpy(raw + 1, entry->d_name, len);
+            copy_to_virt(zos, cpu->de.w, raw, sizeof(raw));
+            return ZOS_ERR_SUCCESS;
+        }
+    }
+    return ZOS_ERR_NO_MORE_ENTRIES;
+}
+
+
+/**
+ * @brief Timeout of a read on the serial driver: the one set by the program, bounded by the
+ *        one given to the host end.
+ */
+static int serial_read_timeout(const zos_t* zos)
+{
+    const int timeout = zos->serial_timeout_ms;
+
+    if (zos->serial_read_timeout == ZOS_SERIAL_TIMEOUT_NONE) {
+        return timeout;
+    }
+    if (timeout < 0 || zos->serial_read_timeout < timeout) {
+        return zos->serial_read_timeout;
+    }
+    return timeout;
+}
+
+
+static uint8_t sys_read(zos_t* zos, uint64_t* cycles)
+{
+    z80_t* cpu = &zos->cpu;
+    const uint8_t dev = cpu->hl.b.h;
+    uint8_t buffer[ZOS_PAGE_SIZE];
+    const uint16_t len = cpu->bc.w > sizeof(buffer) ? sizeof(buffer) : cpu->bc.w;
+    uint64_t stall_ms;
+    int got = 0;
+
+    if (dev >= ZOS_MAX_OPENED_DEV) {
+        return ZOS_ERR_INVALID_DEV;
+    }
+
+    switch (zos->devs[dev]) {
+        case ZOS_DEV_CONSOLE:
+            got = fread(buffer, 1, len, stdin);
+            break;
+        case ZOS_DEV_SERIAL:
+            stall_ms = zos->serial->stall_ms;
+            got = serial_read(zos->serial, buffer, len, serial_read_timeout(zos));
+            *cycles += (zos->serial->stall_ms - stall_ms) * (ZOS_CPU_FREQ / 1000);
+            if (got < 0) {
+                return ZOS_ERR_FAILURE;
+            }
+            *cycles += serial_cycles(zos->serial, got, ZOS_CPU_FREQ);
+            zos->serial_cycles += serial_cycles(zos->serial, got, ZOS_CPU_FREQ);
+            if (got > 0 && zos->first_rx_cycles == 0) {
+                zos->first_rx_cycles = cpu->cycles + *cycles;
+            }
+            break;
+        case ZOS_DEV_FILE:
+            got = fread(buffer, 1, len, zos->files[dev]);
+            *cycles += (uint64_t) got * ZOS_ROMDISK_CYCLES_PER_BYTE;
+            break;
+        default:
+            return ZOS_ERR_INVALID_DEV;
+    }
+
+    copy_to_virt(zos, cpu->de.w, buffer, got);
+    cpu->bc.w = got;
+    return ZOS_ERR_SUCCESS;
+}
+
+
+static uint8_t sys_write(zos_t* zos, uint64_t* cycles)
+{
+    z80_t* cpu = &zos->cpu;
+    const uint8_t dev = cpu->hl.b.h;
+    uint8_t buffer[ZOS_PAGE_SIZE];
+    const uint16_t len = cpu->bc.w > sizeof(buffer) ? sizeof(buffer) : cpu->bc.w;
+    uint64_t stall_ms;
+
+    if (dev >= ZOS_MAX_OPENED_DEV) {
+        return ZOS_ERR_INVALID_DEV;
+    }
+
+    copy_from_virt(zos, cpu->de.w, buffer, len);
+
+    switch (zos->devs[dev]) {
+        case ZOS_DEV_CONSOLE:
+            fwrite(buffer, 1, len, zos->console);
+            fflush(zos->console);
+            break;
+        case ZOS_DEV_SERIAL:
+            stall_ms = zos->serial->stall_ms;
+            if (serial_write(zos->serial, buffer, len) != len) {
+                return ZOS_ERR_FAILURE;
+            }
+            *cycles += (zos->serial->stall_ms - stall_ms) * (ZOS_CPU_FREQ / 1000);
+            *cycles += serial_cycles(zos->serial, len, ZOS_CPU_FREQ);
+            zos->serial_cycles += serial_cycles(zos->serial, len, ZOS_CPU_FREQ);
+            break;
+        default:
+            return ZOS_ERR_INVALID_DEV;
+    }
+
+    cpu->bc.w = len;
+    return ZOS_ERR_SUCCESS;
+}
+
+
+static uint8_t sys_ioctl(zos_t* zos)
+{
+    z80_t* cpu = &zos->cpu;
+    const uint8_t dev = cpu->hl.b.h;
+    const uint16_t arg = cpu->de.w;
+
+    if (dev >= ZOS_MAX_OPENED_DEV || zos->devs[dev] != ZOS_DEV_SERIAL) {
+        return ZOS_ERR_NOT_SUPPORTED;
+    }
+
+    switch (cpu->bc.b.l) {
+        case ZOS_SERIAL_CMD_GET_ATTR:
+            mem_write(zos, arg, zos->serial_attr & 0xff);
+            mem_write(zos, arg + 1, zos->serial_attr >> 8);
+            return ZOS_ERR_SUCCESS;
+        case ZOS_SERIAL_CMD_SET_ATTR:
+            zos->serial_attr = arg;
+            return ZOS_ERR_SUCCESS;
+        case ZOS_SERIAL_CMD_GET_TIMEOUT:
+            mem_write(zos, arg, zos->serial_read_timeout & 0xff);
+            mem_write(zos, arg + 1, zos->serial_read_timeout >> 8);
+            return ZOS_ERR_SUCCESS;
+        case ZOS_SERIAL_CMD_SET_TIMEOUT:
+            zos->serial_read_timeout = arg;
+            return ZOS_ERR_SUCCESS;
+        case ZOS_SERIAL_CMD_SET_BAUDRATE:
+            if (arg == 0) {
+                return ZOS_ERR_INVALID_PARAMETER;
+            }
+            zos->serial->baudrate = arg;
+            return ZOS_ERR_SUCCESS;
+        default:
+            return ZOS_ERR_NOT_SUPPORTED;
+    }
+}
+
+
+static uint8_t sys_close(zos_t* zos)
+{
+    const uint8_t dev = zos->cpu.hl.b.h;
+
+    if (dev >= ZOS_MAX_OPENED_DEV || dev <= ZOS_DEV_STDIN || zos->devs[dev] == ZOS_DEV_NONE) {
+        return ZOS_ERR_INVALID_DEV;
+    }
+    if (zos->devs[dev] == ZOS_DEV_FILE) {
+        fclose(zos->files[dev]);
+    } else if (zos->devs[dev] == ZOS_DEV_DIR) {
+        closedir(zos->dirs[dev]);
+    }
+    zos->devs[dev] = ZOS_DEV_NONE;
+    return ZOS_ERR_SUCCESS;
+}
+
+
+/**
+ * @brief Map the physical address given in H:BC in the virtual page containing DE.
+ */
+static uint8_t sys_map(zos_t* zos)
+{
+    z80_t* cpu = &zos->cpu;
+    const int page = cpu->de.w >> 14;
+    const uint32_t phys = ((uint32_t) cpu->hl.b.h << 16) | cpu->bc.w;
+
+    if (page == 0) {
+        return ZOS_ERR_INVALID_VIRT_PAGE;
+    }
+    if (phys >= ZOS_PHYS_MAX) {
+        return ZOS_ERR_INVALID_PHYS_ADDR;
+    }
+    zos->page_phys[page] = phys & ~(ZOS_PAGE_SIZE - 1);
+    return ZOS_ERR_SUCCESS;
+}
+
+
+/**
+ * @brief Write the time elapsed since the program started, in milliseconds, in the zos_time_t
+ *        structure pointed by DE. The clock given in H is ignored, there is only one.
+ */
+static uint8_t sys_gettime(zos_t* zos)
+{
+    z80_t* cpu = &zos->cpu;
+    const uint16_t millis = (uint16_t) (cpu->cycles / (ZOS_CPU_FREQ / 1000));
+
+    mem_write(zos, cpu->de.w, millis & 0xff);
+    mem_write(zos, cpu->de.w + 1, millis >> 8);
+    return ZOS_ERR_SUCCESS;
+}
+
+
+static void zos_syscall(zos_t* zos)
+{
+    z80_t* cpu = &zos->cpu;
+    const uint8_t num = cpu->hl.b.l;
+    uint64_t cycles = 0;
+    uint8_t ret;
+
+    if (num >= ZOS_SYS_COUNT) {
+        zos->fault = "invalid syscall number";
+        return;
+    }
+
+    switch (num) {
+        case ZOS_SYS_READ:  ret = sys_read(zos, &cycles); break;
+        case ZOS_SYS_WRITE: ret = sys_write(zos, &cycles); break;
+        case ZOS_SYS_OPEN:  ret = sys_open(zos); break;
+        case ZOS_SYS_CLOSE: ret = sys_close(zos); break;
+        case ZOS_SYS_OPENDIR: ret = sys_opendir(zos); break;
+        case ZOS_SYS_READDIR: ret = sys_readdir(zos); break;
+        case ZOS_SYS_IOCTL: ret = sys_ioctl(zos); break;
+        case ZOS_SYS_MAP:   ret = sys_map(zos); break;
+        case ZOS_SYS_GETTIME: ret = sys_gettime(zos); break;
+        case ZOS_SYS_MSLEEP:
+            cycles += (uint64_t) cpu->de.w * (ZOS_CPU_FREQ / 1000);
+            ret = ZOS_ERR_SUCCESS;
+            break;
+        case ZOS_SYS_EXIT:
+            zos->exited = true;
+            zos->exit_code = cpu->hl.b.h;
+            ret = ZOS_ERR_SUCCESS;
+            break;
+        default:
+            ret = ZOS_ERR_NOT_IMPLEMENTED;
+            break;
+    }
+
+    cycles += s_syscall_overhead[num];
+    zos->syscalls[num].count++;
+    zos->syscalls[num].cycles += cycles;
+    cpu->cycles += cycles;
+    cpu->af.b.h = ret;
+
+    /* Let the cartridge clock follow the simulated time */
+    const uint64_t seconds = cpu->cycles / ZOS_CPU_FREQ;
+    if (zos->cart != NULL && seconds > zos->rtc_seconds) {
+        cart_rtc_advance(zos->cart, seconds - zos->rtc_seconds);
+        zos->rtc_seconds = seconds;
+    }
+}
+
+
+int zos_run(zos_t* zos, uint64_t max_cycles)
+{
+    z80_t* cpu = &zos->cpu;
+    uint8_t prev_op = 0;
+
+    while (!zos->exited && zos->fault == NULL) {
+        if (cpu->pc == ZOS_SYSCALL_ADDR) {
+            zos_syscall(zos);
+            /* Return from the RST instruction */
+            cpu->pc = z80_pop(cpu);
+            prev_op = 0xc9;
+            continue;
+        }
+
+        if (zos->profile != NULL) {
+            profile_step(zos->profile, cpu, prev_op);
+            prev_op = mem_read(zos, cpu->pc);
+        }
+
+        if (cpu->pc < ZOS_PAGE_SIZE) {
+            zos->fault = "jump to kernel space";
+        } else if (cpu->halted) {
+            zos->fault = "CPU halted";
+        } else if (max_cycles != 0 && cpu->cycles >= max_cycles) {
+            zos->fault = "maximum number of T-states reached";
+        } else {
+            z80_step(cpu);
+        }
+    }
+
+    if (zos->fault != NULL) {
+        fprintf(stderr, "Emulation stopped at PC=0x%04x: %s\n", cpu->pc, zos->fault);
+        return -1;
+    }
+    return 0;
+}
+
+
+const char* zos_syscall_name(int num)
+{
+    return (num >= 0 && num < ZOS_SYS_COUNT) ? s_syscall_names[num] : "?";
+}
+
+
+void zos_print_stats(const zos_t* zos, FILE* out)
+{
+    const uint64_t cycles = zos->cpu.cycles;
+
+    fprintf(out, "T-states: %llu (%.3f s at %d MHz)\n", (unsigned long long) cycles,
+            (double) cycles / ZOS_CPU_FREQ, ZOS_CPU_FREQ / 1000000);
+    for (int i = 0; i < ZOS_SYS_COUNT; i++) {
+        if (zos->syscalls[i].count) {
+            fprintf(out, "  %-8s %8llu calls %12llu T-states\n", zos_syscall_name(i),
+                    (unsigned long long) zos->syscalls[i].count,
+                    (unsigned long long) zos->syscalls[i].cycles);
+        }
+    }
+    if (zos->serial != NULL) {
+        fprintf(out, "Serial: %llu bytes sent, %llu bytes received\n",
+                (unsigned long long) zos->serial->tx_bytes,
+                (unsigned long long) zos->serial->rx_bytes);
+    }
+}
@@ -0,0 +1,181 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include "z80.h"
+#include "cart.h"
+#include "serial.h"
+#include "profile.h"
+
+/**
+ * Emulation of a Zeal 8-bit Computer running Zeal 8-bit OS, only what user programs can see:
+ * four 16KB virtual pages, the first one being the kernel, and the syscalls reached with `RST 0x08`.
+ */
+
+#define ZOS_CPU_FREQ            10000000
+#define ZOS_PAGE_SIZE           0x4000
+#define ZOS_PROGRAM_ADDR        0x4000
+#define ZOS_SYSCALL_ADDR        0x0008
+
+/* Physical memory map */
+#define ZOS_PHYS_RAM            0x080000
+#define ZOS_PHYS_RAM_SIZE       (512*1024)
+#define ZOS_PHYS_MAX            0x400000
+
+/* Syscall numbers, passed in register L */
+typedef enum {
+    ZOS_SYS_READ = 0,
+    ZOS_SYS_WRITE,
+    ZOS_SYS_OPEN,
+    ZOS_SYS_CLOSE,
+    ZOS_SYS_DSTAT,
+    ZOS_SYS_STAT,
+    ZOS_SYS_SEEK,
+    ZOS_SYS_IOCTL,
+    ZOS_SYS_MKDIR,
+    ZOS_SYS_GETDIR,
+    ZOS_SYS_CHDIR,
+    ZOS_SYS_OPENDIR,
+    ZOS_SYS_READDIR,
+    ZOS_SYS_RM,
+    ZOS_SYS_MOUNT,
+    ZOS_SYS_EXIT,
+    ZOS_SYS_EXEC,
+    ZOS_SYS_DUP,
+    ZOS_SYS_MSLEEP,
+    ZOS_SYS_SETTIME,
+    ZOS_SYS_GETTIME,
+    ZOS_SYS_SETDATE,
+    ZOS_SYS_GETDATE,
+    ZOS_SYS_MAP,
+    ZOS_SYS_SWAP,
+    ZOS_SYS_PALLOC,
+    ZOS_SYS_PFREE,
+    ZOS_SYS_COUNT
+} zos_syscall_t;
+
+/* Subset of zos_errors.h used by the emulation */
+#define ZOS_ERR_SUCCESS             0
+#define ZOS_ERR_FAILURE             1
+#define ZOS_ERR_NOT_IMPLEMENTED     2
+#define ZOS_ERR_NOT_SUPPORTED       3
+#define ZOS_ERR_NO_SUCH_ENTRY       4
+#define ZOS_ERR_INVALID_PARAMETER   6
+#define ZOS_ERR_INVALID_VIRT_PAGE   7
+#define ZOS_ERR_INVALID_PHYS_ADDR   8
+#define ZOS_ERR_INVALID_DEV         13
+#define ZOS_ERR_READ_ONLY           18
+#define ZOS_ERR_CANNOT_REGISTER     20
+#define ZOS_ERR_NO_MORE_ENTRIES     21
+
+/* Subset of zos_vfs.h */
+#define ZOS_DEV_STDOUT              0
+#define ZOS_DEV_STDIN               1
+#define ZOS_MAX_OPENED_DEV          16
+#define ZOS_O_RDONLY                0
+#define ZOS_FILENAME_LEN_MAX        16
+#define ZOS_D_ISFILE                1
+/* Disk backed by the host directory given to zos_init, the romdisk */
+#define ZOS_ROMDISK_PREFIX          "A:/"
+
+/* Serial driver ioctl commands and attributes, from zos_serial.h */
+#define ZOS_SERIAL_CMD_GET_ATTR     0
+#define ZOS_SERIAL_CMD_SET_ATTR     1
+#define ZOS_SERIAL_CMD_GET_BAUDRATE 2
+#define ZOS_SERIAL_CMD_SET_BAUDRATE 3
+#define ZOS_SERIAL_CMD_GET_TIMEOUT  4
+#define ZOS_SERIAL_CMD_SET_TIMEOUT  5
+#define ZOS_SERIAL_ATTR_MODE_RAW    (1 << 0)
+/* Read timeout of the serial driver, in milliseconds, 0 makes the reads return immediately */
+#define ZOS_SERIAL_TIMEOUT_NONE     0xffff
+
+typedef enum {
+    ZOS_DEV_NONE = 0,
+    ZOS_DEV_CONSOLE,
+    ZOS_DEV_SERIAL,
+    ZOS_DEV_FILE,
+    ZOS_DEV_DIR,
+} zos_dev_kind_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t cycles;
+} zos_stat_t;
+
+typedef struct {
+    z80_t     cpu;
+    uint8_t*  ram;
+    uint32_t  page_phys[4];
+    cart_t*   cart;
+    serial_t* serial;
+    zos_dev_kind_t devs[ZOS_MAX_OPENED_DEV];
+    /* Host files and directories behind the opened ZOS_DEV_FILE and ZOS_DEV_DIR */
+    FILE*     files[ZOS_MAX_OPENED_DEV];
+    DIR*      dirs[ZOS_MAX_OPENED_DEV];
+    /* Host directory whose files are visible in A:/, NULL if none */
+    const char* romdisk;
+    uint16_t  serial_attr;
+    /* Read timeout set by the program, ZOS_SERIAL_TIMEOUT_NONE to wait forever */
+    uint16_t  serial_read_timeout;
+    /* Serial read timeout given to the host end, in milliseconds, negative for none */
+    int       serial_timeout_ms;
+    FILE*     console;
+    /* Address decode of the adapter, generated from the PLD equations (pld_decode.h) */
+    const struct pld_entry_t* decode;
+
+    bool      exited;
+    uint8_t   exit_code;
+    /* Set when the emulation must be stopped because of an error */
+    const char* fault;
+    /* Simulated seconds already given to the cartridge RTC */
+    uint64_t  rtc_seconds;
+
+    zos_stat_t syscalls[ZOS_SYS_COUNT];
+    /* T-states spent transferring bytes on the UART, included in the syscalls statistics */
+    uint64_t  serial_cycles;
+    /* Value of the T-states counter when the first byte was received from the host */
+    uint64_t  first_rx_cycles;
+    /* Optional function-level profiler */
+    profile_t* profile;
+} zos_t;
+
+
+/**
+ * @brief Initialize the machine and load the program at 0x4000. `cart` can be NULL
+ *        (empty slot) and so can `serial`.
+ *
+ * @returns 0 on success, -1 on error.
+ */
+int zos_init(zos_t* zos, const char* program, cart_t* cart, serial_t* serial);
+
+/**
+ * @brief Select the address decode of the given PLD design, by its CUPL name. The first design
+ *        given to pld/pldsim.py, the adapter one, is used by default.
+ *
+ * @returns 0 on success, -1 if the design is unknown.
+ */
+int zos_set_decode(zos_t* zos, const char* design);
+
+void zos_free(zos_t* zos);
+
+/**
+ * @brief Run the program until it exits, faults or until `max_cycles` T-states
+ *        have been executed (0 for no limit).
+ *
+ * @returns 0 if the program exited, -1 else.
+ */
+int zos_run(zos_t* zos, uint64_t max_cycles);
+
+/**
+ * @brief Print the syscalls statistics on the given stream
+ */
+void zos_print_stats(const zos_t* zos, FILE* out);
+
+const char* zos_syscall_name(int num);
@@ -0,0 +1,44 @@
+# Decoder of the Game Boy Camera photos received with `dump.py --camera`.
+#
+# Each photo slot is 4KB: the 128x112 image, stored as 16x14 tiles of 8x8 pixels, then its thumbnail
+# and its metadata. A tile row is two bytes, the low and the high bit planes, leftmost pixel in the
+# most significant bit. The whole image is decoded at once with numpy, without any per-pixel loop.
+
+import struct
+import zlib
+
+import numpy as np
+
+PHOTO_SIZE = 4096
+WIDTH = 128
+HEIGHT = 112
+TILES_X = WIDTH // 8
+TILES_Y = HEIGHT // 8
+IMAGE_SIZE = TILES_X * TILES_Y * 16
+
+# Color 0 is white, color 3 is black
+GRAYS = np.array([0xff, 0xaa, 0x55, 0x00], dtype=np.uint8)
+
+
+def decode_photo(photo):
+    """Return the photo as a HEIGHT x WIDTH array of gray levels"""
+    tiles = np.frombuffer(photo[:IMAGE_SIZE], dtype=np.uint8).reshape(TILES_Y, TILES_X, 8, 2, 1)
+    bits = np.unpackbits(tiles, axis=-1)
+    colors = bits[..., 0, :] | (bits[..., 1, :] << 1)
+    # (tile row, tile column, pixel row, pixel column) to (tile row, pixel row, tile column, pixel column)
+    return GRAYS[colors.transpose(0, 2, 1, 3).reshape(HEIGHT, WIDTH)]
+
+
+def write_png(path, pixels):
+    """Write a grayscale 8-bit PNG"""
+    height, width = pixels.shape
+    raw = np.hstack([np.zeros((height, 1), dtype=np.uint8), pixels]).tobytes()
+
+    def chunk(kind, data):
+        return struct.pack(">I", len(data)) + kind + data + struct.pack(">I", zlib.crc32(kind + data))
+
+    with open(path, "wb") as f:
+        f.write(b'\x89PNG\r\n\x1a\n')
+        f.write(chunk(b'IHDR', struct.pack(">IIBBBBB", width, height, 8, 0, 0, 0, 0)))
+        f.write(chunk(b'IDAT', zlib.compress(raw, 9)))
+        f.write(chunk(b'IEND', b''))
@@ -0,0 +1,235 @@
+# Encoders and decoders for the transfer encodings between the host and Zeal 8-bit Computer.
+# The formats are chosen to be decoded with a few Z80 instructions per byte.
+#
+# RLE (PackBits-like), a sequence of packets:
+#   0x00-0x7F n: n+1 literal bytes follow
+#   0x80-0xFF n: the next byte is repeated (n - 0x80 + 2) times (2 to 129)
+#
+# LZ (LZSS), groups of 8 items preceded by a flag byte, LSB first:
+#   bit 0: literal byte
+#   bit 1: match of 2 bytes: offset low byte, then (offset high nibble << 4) | (length - 3)
+#          offset is the distance backward (1 to 4095), length is 3 to 18
+#
+# Nibble-pack, for 4-bit data such as MBC2 RAM, the first byte is the upper nibble shared by all
+# the bytes (0x00 or 0xF0), then each byte holds two lower nibbles (first one in the low nibble).
+# A first byte of 0xFF means the data could not be packed and follows as-is.
+#
+# Compressed restores send each bank as frames of complete RLE packets or LZ groups, decoded by the
+# 8-bit computer in the bank as they arrive (see CMD_RESTORE_PACKED in software/src/protocol.h).
+
+RLE_MAX_LITERALS = 128
+RLE_MAX_RUN = 129
+
+LZ_MIN_MATCH = 3
+LZ_MAX_MATCH = 18
+LZ_MAX_OFFSET = 4095
+LZ_MAX_CHAIN = 16
+
+NIBBLE_RAW = 0xFF
+
+# Must match software/src/protocol.h and UNPACK_FRAME_SIZE in software/src/unpack.h
+PACK_RAW = 0
+PACK_RLE = 1
+PACK_LZ = 2
+PACK_END = 0xFF
+PACK_FRAME_MAX = 1024
+
+
+def rle_encode(data):
+    out = bytearray()
+    literals = bytearray()
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and run < RLE_MAX_RUN and data[i + run] == data[i]:
+            run += 1
+        if run >= 2:
+            if literals:
+                out.append(len(literals) - 1)
+                out += literals
+                literals = bytearray()
+            out.append(0x80 + run - 2)
+            out.append(data[i])
+            i += run
+        else:
+            literals.append(data[i])
+            i += 1
+            if len(literals) == RLE_MAX_LITERALS:
+                out.append(len(literals) - 1)
+                out += literals
+                literals = bytearray()
+    if literals:
+        out.append(len(literals) - 1)
+        out += literals
+    return bytes(out)
+
+
+def rle_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        ctrl = data[i]
+        if ctrl < 0x80:
+            out += data[i + 1:i + 2 + ctrl]
+            i += 2 + ctrl
+        else:
+            out += bytes([data[i + 1]]) * (ctrl - 0x80 + 2)
+            i += 2
+    return bytes(out)
+
+
+def lz_encode(data):
+    out = bytearray()
+    chains = {}
+    flags_pos = -1
+    item = 8
+    i = 0
+    while i < len(data):
+        if item == 8:
+            flags_pos = len(out)
+            out.append(0)
+            item = 0
+        # Look for the longest match among the last positions sharing the same 3 bytes
+        best_len = 0
+        best_off = 0
+        key = bytes(data[i:i + LZ_MIN_MATCH])
+        candidates = chains.get(key, [])
+        for pos in reversed(candidates):
+            off = i - pos
+            if off > LZ_MAX_OFFSET:
+                break
+            length = 0
+            while length < LZ_MAX_MATCH and i + length < len(data) and data[pos + length] == data[i + length]:
+                length += 1
+            if length > best_len:
+                best_len = length
+                best_off = off
+                if length == LZ_MAX_MATCH:
+                    break
+        step = 1
+        if best_len >= LZ_MIN_MATCH:
+            out[flags_pos] |= 1 << item
+            out.append(best_off & 0xff)
+            out.append(((best_off >> 8) << 4) | (best_len - LZ_MIN_MATCH))
+            step = best_len
+        else:
+            out.append(data[i])
+        for j in range(i, i + step):
+            chain = chains.setdefault(bytes(data[j:j + LZ_MIN_MATCH]), [])
+            chain.append(j)
+            if len(chain) > LZ_MAX_CHAIN:
+                del chain[0]
+        i += step
+        item += 1
+    return bytes(out)
+
+
+def lz_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        flags = data[i]
+        i += 1
+        for item in range(8):
+            if i >= len(data):
+                break
+            if flags & (1 << item):
+                off = data[i] | ((data[i + 1] >> 4) << 8)
+                length = (data[i + 1] & 0xf) + LZ_MIN_MATCH
+                for _ in range(length):
+                    out.append(out[-off])
+                i += 2
+            else:
+                out.append(data[i])
+                i += 1
+    return bytes(out)
+
+
+def nibble_encode(data):
+    upper = data[0] & 0xf0 if data else 0
+    if (upper not in (0x00, 0xf0)) or any((b & 0xf0) != upper for b in data):
+        return bytes([NIBBLE_RAW]) + bytes(data)
+    out = bytearray([upper])
+    for i in range(0, len(data), 2):
+        low = data[i] & 0xf
+        high = data[i + 1] & 0xf if i + 1 < len(data) else 0
+        out.append(low | (high << 4))
+    return bytes(out)
+
+
+def nibble_decode(data, size):
+    if data[0] == NIBBLE_RAW:
+        return bytes(data[1:1 + size])
+    upper = data[0]
+    out = bytearray()
+    for b in data[1:]:
+        out.append(upper | (b & 0xf))
+        out.append(upper | (b >> 4))
+    return bytes(out[:size])
+
+
+ENCODERS = {
+    "rle": rle_encode,
+    "lz": lz_encode,
+    "nibble": nibble_encode,
+}
+
+
+def block_hash(data):
+    """Hash of a block, same as hash_block in software/src/hash.c"""
+    sum1 = sum2 = 0
+    for b in data:
+        sum1 = (sum1 + b) & 0xffff
+        sum2 = (sum2 + sum1) & 0xffff
+    return (sum2 << 16) | sum1
+
+
+def _rle_items(stream):
+    """Yield the size and the decoded size of each RLE packet"""
+    i = 0
+    while i < len(stream):
+        ctrl = stream[i]
+        if ctrl < 0x80:
+            yield 2 + ctrl, ctrl + 1
+            i += 2 + ctrl
+        else:
+            yield 2, ctrl - 0x80 + 2
+            i += 2
+
+
+def _lz_items(stream):
+    """Yield the size and the decoded size of each LZ group"""
+    i = 0
+    while i < len(stream):
+        flags = stream[i]
+        size, decoded = 1, 0
+        for item in range(8):
+            if i + size >= len(stream):
+                break
+            if flags & (1 << item):
+                decoded += (stream[i + size + 1] & 0xf) + LZ_MIN_MATCH
+                size += 2
+            else:
+                decoded += 1
+                size += 1
+        yield size, decoded
+        i += size
+
+
+def pack_frames(data):
+    """Encode a bank for a compressed restore with RLE or LZ, whichever is smaller, or as-is when
+    neither helps. Returns a list of (type, payload, decoded size), the end frame is not included."""
+    candidates = [(PACK_RLE, rle_encode(data), _rle_items), (PACK_LZ, lz_encode(data), _lz_items)]
+    kind, stream, items = min(candidates, key=lambda c: len(c[1]))
+    if len(stream) >= len(data):
+        return [(PACK_RAW, bytes(data), len(data))]
+    frames = []
+    start = size = decoded = 0
+    for item_size, item_decoded in items(stream):
+        if size + item_size > PACK_FRAME_MAX:
+            frames.append((kind, stream[start:start + size], decoded))
+            start, size, decoded = start + size, 0, 0
+        size += item_size
+        decoded += item_decoded
+    frames.append((kind, stream[start:start + size], decoded))
+    return frames
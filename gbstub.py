@@ -0,0 +1,128 @@
+# Builder and library of the code stubs uploaded to gbdump in resident mode (see software/src/stub.h).
+#
+# A stub is assembled twice, at origin 0x0000 and at origin 0x0100, the relocations are the 16-bit
+# words that differ by 0x0100 between both images. It starts with the gb_stub_t header:
+#   jp entry
+#   data: .dw 0     ; parameters set by gbdump before each call: bank address, size and number
+#   size: .dw 0
+#   bank: .db 0
+#
+# The library files (.stub) contain a header followed by the blob sent after the 'U' command:
+#   'GBST', version (8-bit)
+#   encoding of the data sent back by the stub (8-bit), index in ENCODINGS
+#   cost of the stub, in T-states per byte (16-bit), the cheapest one is picked
+#   number of cartridge types supported (8-bit), 0 for all of them, followed by the types
+#   blob: size of the code (16-bit), number of relocations (16-bit), code, relocations (16-bit),
+#         8-bit sum of the code and the relocations
+# All the 16-bit values are little-endian.
+
+import argparse
+import os
+import struct
+
+import gbcodec
+
+STUB_MAGIC = b'GBST'
+STUB_VERSION = 1
+# Must match GB_STUB_SIZE and sizeof(gb_stub_t) in software/src/stub.h
+STUB_SIZE_MAX = 1024
+STUB_HEADER_SIZE = 8
+RELOC_ORIGIN = 0x0100
+
+ENCODINGS = ["raw", "rle", "lz", "nibble"]
+
+
+class Stub:
+    def __init__(self, name, blob, encoding="raw", cost=0, types=()):
+        self.name = name
+        self.blob = blob
+        self.encoding = encoding
+        self.cost = cost
+        self.types = list(types)
+
+    def supports(self, cart_type):
+        return not self.types or cart_type in self.types
+
+    def decode(self, data, bank_size):
+        if self.encoding == "rle":
+            return gbcodec.rle_decode(data)
+        if self.encoding == "lz":
+            return gbcodec.lz_decode(data)
+        if self.encoding == "nibble":
+            return gbcodec.nibble_decode(data, bank_size)
+        return data
+
+    def to_bytes(self):
+        header = STUB_MAGIC + struct.pack("<BBHB", STUB_VERSION, ENCODINGS.index(self.encoding),
+                                          self.cost, len(self.types))
+        return header + bytes(self.types) + self.blob
+
+
+def build_blob(image0, image1):
+    """Create the blob from the images of the stub assembled at 0x0000 and at RELOC_ORIGIN"""
+    if len(image0) != len(image1):
+        raise ValueError("both images must have the same size")
+    if len(image0) < STUB_HEADER_SIZE or len(image0) > STUB_SIZE_MAX:
+        raise ValueError("the stub must be between %d and %d bytes" % (STUB_HEADER_SIZE, STUB_SIZE_MAX))
+    relocs = []
+    i = 0
+    while i < len(image0):
+        if image0[i] == image1[i]:
+            i += 1
+            continue
+        # Only the high byte of an absolute address changes, the low byte is the previous one
+        word0 = struct.unpack_from("<H", image0, i - 1)[0] if i > 0 else None
+        word1 = struct.unpack_from("<H", image1, i - 1)[0] if i > 0 else None
+        if word0 is None or word1 - word0 != RELOC_ORIGIN:
+            raise ValueError("difference at offset 0x%x is not a 16-bit address" % i)
+        relocs.append(i - 1)
+        i += 1
+    code = bytes(image0)
+    reloc_bytes = b''.join(struct.pack("<H", r) for r in relocs)
+    checksum = (sum(code) + sum(reloc_bytes)) & 0xff
+    return struct.pack("<HH", len(code), len(relocs)) + code + reloc_bytes + bytes([checksum])
+
+
+def parse(name, data):
+    if data[:4] != STUB_MAGIC or data[4] != STUB_VERSION:
+        raise ValueError("%s is not a stub" % name)
+    encoding, cost, count = struct.unpack_from("<BHB", data, 5)
+    types = data[9:9 + count]
+    return Stub(name, data[9 + count:], ENCODINGS[encoding], cost, types)
+
+
+def load_library(path):
+    stubs = []
+    for entry in sorted(os.listdir(path)):
+        if entry.endswith(".stub"):
+            with open(os.path.join(path, entry), "rb") as f:
+                stubs.append(parse(entry, f.read()))
+    return stubs
+
+
+def pick(stubs, cart_type):
+    """Return the cheapest stub supporting the given cartridge type, None if there is none"""
+    candidates = [s for s in stubs if s.supports(cart_type)]
+    return min(candidates, key=lambda s: s.cost) if candidates else None
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+                prog='gbstub.py',
+                description='Create a gbdump stub from the binaries assembled at 0x0000 and 0x0100'
+            )
+    parser.add_argument('-o', dest='outfile', help='Output stub file name (.stub)', required=True)
+    parser.add_argument('-e', dest='encoding', choices=ENCODINGS, default="raw",
+                        help='Encoding of the data sent back by the stub')
+    parser.add_argument('-c', dest='cost', type=int, default=0, help='Cost, in T-states per byte')
+    parser.add_argument('-t', dest='types', default="",
+                        help='Comma-separated cartridge types supported, e.g. 0x03,0x1b, all by default')
+    parser.add_argument('image0', help='Stub assembled at 0x0000')
+    parser.add_argument('image1', help='Stub assembled at 0x0100')
+    args = parser.parse_args()
+
+    with open(args.image0, "rb") as f0, open(args.image1, "rb") as f1:
+        blob = build_blob(f0.read(), f1.read())
+    types = [int(t, 0) for t in args.types.split(",") if t]
+    with open(args.outfile, "wb") as f:
+        f.write(Stub(args.outfile, blob, args.encoding, args.cost, types).to_bytes())
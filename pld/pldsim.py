@@ -0,0 +1,353 @@
+import argparse
+import os
+import re
+import sys
+
+# Logic simulator for the CUPL sources of the adapter PLD (GAL16V8). It parses the pin declarations
+# and the combinational rules, evaluates every input combination and checks the result against the
+# physical memory map the software expects. It can also export the resulting decode as a C table
+# for the emulator (see emulator/src/zos.c).
+#
+# Board wiring (see pcb/): Zeal A0-A14 go to the cartridge, CS_ROM drives the cartridge A15 and
+# CS_SRAM drives the cartridge /CS. If the design has a CART_A14 output, it drives the cartridge A14
+# instead of the Zeal A14.
+
+# Physical address of the cartridge window, GB_PHYS_ADDR in software/src/main.c
+GB_PHYS_ADDR = 0x3f0000
+PHYS_ADDR_BITS = 22
+# Decode granularity, A13 is the lowest address line a design may use
+GRANULE_BITS = 13
+
+# GAL16V8 in simple mode: pins 15 and 16 can't be used as inputs
+G16V8_INPUT_PINS = set(range(1, 10)) | {11, 12, 13, 14, 17, 18, 19}
+G16V8_OUTPUT_PINS = set(range(12, 20))
+
+SEL_NONE = "none"
+SEL_ROM = "rom"
+SEL_SRAM = "sram"
+
+
+class PldError(Exception):
+    pass
+
+
+class Pld:
+    def __init__(self, path):
+        self.path = path
+        self.name = None
+        # Pin number -> (name, active_low)
+        self.pins = {}
+        # Output name -> expression AST
+        self.rules = {}
+        self._parse(path)
+
+    def _parse(self, path):
+        with open(path) as f:
+            text = f.read()
+        text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+        for statement in text.split(";"):
+            statement = " ".join(statement.split())
+            if not statement:
+                continue
+            m = re.match(r"^Name\s+(\S+)$", statement, re.I)
+            if m:
+                self.name = m.group(1)
+                continue
+            m = re.match(r"^Pin\s+(\d+)\s*=\s*(!?)\s*(\w+)$", statement, re.I)
+            if m:
+                self.pins[int(m.group(1))] = (m.group(3), m.group(2) == "!")
+                continue
+            m = re.match(r"^(\w+)\s*=\s*(.+)$", statement)
+            if m:
+                self.rules[m.group(1)] = Parser(m.group(2)).parse()
+                continue
+            # Other header fields (Partno, Rev, Device, ...) are not needed
+            if not re.match(r"^(Partno|Rev|Date|Designer|Company|Location|Assembly|Device)\b", statement, re.I):
+                raise PldError("%s: cannot parse '%s'" % (path, statement))
+
+        names = {name for name, _ in self.pins.values()}
+        for output, expr in self.rules.items():
+            if output not in names:
+                raise PldError("%s: rule for undeclared pin %s" % (path, output))
+            for var in variables(expr):
+                if var not in names:
+                    raise PldError("%s: %s uses undeclared pin %s" % (path, output, var))
+
+    @property
+    def inputs(self):
+        return [name for name, _ in sorted(self.pins.values()) if name not in self.rules]
+
+    @property
+    def outputs(self):
+        return [name for name, _ in sorted(self.pins.values()) if name in self.rules]
+
+    def active_low(self, name):
+        return any(pin_name == name and low for pin_name, low in self.pins.values())
+
+    def evaluate(self, levels):
+        """Given the electrical level of each input pin, return the level of each output pin"""
+        values = {name: level ^ self.active_low(name) for name, level in levels.items()}
+        return {out: evaluate(expr, values) ^ self.active_low(out) for out, expr in self.rules.items()}
+
+
+class Parser:
+    """Recursive descent parser for CUPL expressions: ! (not), & (and), # (or), $ (xor)"""
+
+    def __init__(self, text):
+        self.tokens = re.findall(r"\w+|[!&#$()]", text)
+        self.pos = 0
+
+    def parse(self):
+        expr = self._or()
+        if self.pos != len(self.tokens):
+            raise PldError("unexpected '%s'" % self.tokens[self.pos])
+        return expr
+
+    def _peek(self):
+        return self.tokens[self.pos] if self.pos < len(self.tokens) else None
+
+    def _or(self):
+        node = self._xor()
+        while self._peek() == "#":
+            self.pos += 1
+            node = ("or", node, self._xor())
+        return node
+
+    def _xor(self):
+        node = self._and()
+        while self._peek() == "$":
+            self.pos += 1
+            node = ("xor", node, self._and())
+        return node
+
+    def _and(self):
+        node = self._not()
+        while self._peek() == "&":
+            self.pos += 1
+            node = ("and", node, self._not())
+        return node
+
+    def _not(self):
+        if self._peek() == "!":
+            self.pos += 1
+            return ("not", self._not())
+        if self._peek() == "(":
+            self.pos += 1
+            node = self._or()
+            if self._peek() != ")":
+                raise PldError("missing ')'")
+            self.pos += 1
+            return node
+        token = self._peek()
+        if token is None or not re.match(r"\w+$", token):
+            raise PldError("unexpected '%s'" % token)
+        self.pos += 1
+        return ("var", token)
+
+
+def variables(expr):
+    if expr[0] == "var":
+        return {expr[1]}
+    return set().union(*(variables(e) for e in expr[1:]))
+
+
+def evaluate(expr, values):
+    op = expr[0]
+    if op == "var":
+        return values[expr[1]]
+    if op == "not":
+        return not evaluate(expr[1], values)
+    a = evaluate(expr[1], values)
+    b = evaluate(expr[2], values)
+    return {"and": a and b, "or": a or b, "xor": a != b}[op]
+
+
+def cart_view(pld, phys, mreq=True):
+    """What the cartridge sees when Zeal accesses the given physical address.
+       Returns (selection, cartridge address of the 8KB granule), or (None, reason) on conflict."""
+    levels = {}
+    for name in pld.inputs:
+        m = re.match(r"^A(\d+)$", name)
+        if m:
+            levels[name] = bool((phys >> int(m.group(1))) & 1)
+        elif name == "MREQ":
+            # MREQ is active low on the Zeal bus
+            levels[name] = not mreq
+        else:
+            levels[name] = False
+    out = pld.evaluate(levels)
+
+    rom_cs = not out.get("CS_ROM", True)
+    sram_cs = not out.get("CS_SRAM", True)
+    if rom_cs and sram_cs:
+        return (None, "CS_ROM and CS_SRAM both asserted")
+
+    # Cartridge address lines A13-A15 for this granule
+    cart_a15 = 0 if rom_cs else 1
+    cart_a14 = out["CART_A14"] if "CART_A14" in out else (phys >> 14) & 1
+    cart_a13 = (phys >> 13) & 1
+    cart_addr = (cart_a15 << 15) | (int(cart_a14) << 14) | (cart_a13 << 13)
+
+    if rom_cs:
+        return (SEL_ROM, cart_addr)
+    if sram_cs:
+        return (SEL_SRAM, cart_addr)
+    return (SEL_NONE, 0)
+
+
+def expected_linear(phys):
+    """Original design: the 64KB window maps linearly, ROM (and MBC registers) then SRAM"""
+    if phys >> 16 != GB_PHYS_ADDR >> 16:
+        return (SEL_NONE, 0)
+    offset = phys & 0xffff
+    if offset < 0x8000:
+        return (SEL_ROM, offset & 0xe000)
+    return (SEL_SRAM, offset & 0xe000)
+
+
+def expected_alias(phys):
+    """Alias design: same as the linear one, except for the last 16KB page, which holds the RAM bank
+       register (cartridge 0x4000) and the SRAM (cartridge 0xA000), so that one mapping is enough"""
+    offset = phys & 0xffff
+    if phys >> 16 != GB_PHYS_ADDR >> 16 or offset < 0xc000:
+        return expected_linear(phys)
+    if offset < 0xe000:
+        return (SEL_ROM, 0x4000)
+    return (SEL_SRAM, 0xa000)
+
+
+# Expected memory map of each design, by CUPL name
+EXPECTED_MAPS = {
+    "ZealGBCDumper": expected_linear,
+    "ZealGBCDumperAlias": expected_alias,
+}
+
+
+def check(pld):
+    """Evaluate all the input combinations, return a list of errors"""
+    errors = []
+    expected = EXPECTED_MAPS.get(pld.name)
+    if expected is None:
+        return ["no expected memory map for design %s" % pld.name]
+
+    for pin, (name, _) in sorted(pld.pins.items()):
+        allowed = G16V8_OUTPUT_PINS if name in pld.rules else G16V8_INPUT_PINS
+        if pin not in allowed:
+            errors.append("pin %d can't be used as %s %s" % (pin, "output" if name in pld.rules else "input", name))
+
+    # Exhaustive pass over the pins themselves: outputs must never conflict
+    inputs = pld.inputs
+    for combination in range(1 << len(inputs)):
+        levels = {name: bool((combination >> i) & 1) for i, name in enumerate(inputs)}
+        out = pld.evaluate(levels)
+        if not out.get("CS_ROM", True) and not out.get("CS_SRAM", True):
+            errors.append("both chip selects asserted for inputs %s" %
+                          " ".join("%s=%d" % (n, levels[n]) for n in inputs))
+
+    # Then the memory map, for each 8KB granule of the physical address space
+    for granule in range(1 << (PHYS_ADDR_BITS - GRANULE_BITS)):
+        phys = granule << GRANULE_BITS
+        idle = cart_view(pld, phys, mreq=False)
+        if idle[0] != SEL_NONE:
+            errors.append("0x%06x: cartridge selected while MREQ is not asserted" % phys)
+        got = cart_view(pld, phys)
+        want = expected(phys)
+        if got != want:
+            errors.append("0x%06x: got %s 0x%04x, expected %s 0x%04x" %
+                          (phys, got[0], got[1] if isinstance(got[1], int) else 0, want[0], want[1]))
+    return errors
+
+
+def c_identifier(pld):
+    return "pld_" + re.sub(r"\W", "_", os.path.splitext(os.path.basename(pld.path))[0]).lower()
+
+
+def export_header(plds, path):
+    lines = [
+        "/* Generated by pld/pldsim.py, do not edit. */",
+        "",
+        "#pragma once",
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "#define PLD_SEL_NONE    0",
+        "#define PLD_SEL_ROM     1",
+        "#define PLD_SEL_SRAM    2",
+        "",
+        "/* Decode of a physical 8KB granule: selected chip and cartridge address (A13-A15) */",
+        "typedef struct pld_entry_t {",
+        "    uint8_t  sel;",
+        "    uint16_t cart_addr;",
+        "} pld_entry_t;",
+        "",
+        "typedef struct {",
+        "    const char* name;",
+        "    const pld_entry_t* decode;",
+        "} pld_design_t;",
+        "",
+        "#define PLD_ENTRIES     %d" % (1 << (PHYS_ADDR_BITS - GRANULE_BITS)),
+        "#define PLD_GRANULE_BITS %d" % GRANULE_BITS,
+    ]
+    sel_names = {SEL_NONE: "PLD_SEL_NONE", SEL_ROM: "PLD_SEL_ROM", SEL_SRAM: "PLD_SEL_SRAM"}
+    for pld in plds:
+        lines += ["", "/* %s (%s) */" % (pld.name, os.path.basename(pld.path)),
+                  "static const pld_entry_t %s[PLD_ENTRIES] = {" % c_identifier(pld)]
+        for granule in range(1 << (PHYS_ADDR_BITS - GRANULE_BITS)):
+            sel, addr = cart_view(pld, granule << GRANULE_BITS)
+            if sel != SEL_NONE:
+                lines.append("    [0x%03x] = { %s, 0x%04x }," % (granule, sel_names[sel], addr))
+        lines.append("};")
+    lines += ["", "static const pld_design_t pld_designs[] = {"]
+    lines += ["    { \"%s\", %s }," % (pld.name, c_identifier(pld)) for pld in plds]
+    lines += ["    { NULL, NULL }", "};"]
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def print_map(pld):
+    """Print the cartridge window as seen by the software"""
+    print("%s (%s):" % (pld.name, pld.path))
+    for granule in range((GB_PHYS_ADDR >> GRANULE_BITS), 1 << (PHYS_ADDR_BITS - GRANULE_BITS)):
+        phys = granule << GRANULE_BITS
+        sel, addr = cart_view(pld, phys)
+        print("  0x%06x-0x%06x: %-4s %s" % (phys, phys + (1 << GRANULE_BITS) - 1, sel,
+                                           "cartridge 0x%04x" % addr if sel in (SEL_ROM, SEL_SRAM) else ""))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+                    prog='pldsim.py',
+                    description='Simulate and check the GAL16V8 equations of the adapter'
+                )
+    parser.add_argument('files', nargs='+', help='CUPL source files')
+    parser.add_argument('--header', dest='header', help='Export the decode tables to this C header')
+    parser.add_argument('-v', '--verbose', dest='verbose', action='store_true', help='Print the decoded window')
+    args = parser.parse_args()
+
+    plds = []
+    failed = False
+    for path in args.files:
+        try:
+            pld = Pld(path)
+        except PldError as e:
+            print(e)
+            return 1
+        errors = check(pld)
+        if args.verbose:
+            print_map(pld)
+        for error in errors:
+            print("%s: %s" % (path, error))
+        print("%s: %s" % (path, "FAILED, %d error(s)" % len(errors) if errors else "OK"))
+        failed |= bool(errors)
+        plds.append(pld)
+
+    if failed:
+        return 1
+    if args.header:
+        export_header(plds, args.header)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,51 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * MBC driver overlays, loaded by gbdump-core.bin from the romdisk (mbc1.ovl, mbc5.ovl, ...).
+ * An overlay is linked at GB_OVERLAY_ADDR, at the end of the program page, and starts with a
+ * gb_driver_t header. Its code follows the header, at GB_OVERLAY_ADDR + 0x20. Overlays must not
+ * have any writable global variable and can't use the syscalls directly, they use the services
+ * of the core instead.
+ */
+#ifndef GB_OVERLAY_ADDR
+#define GB_OVERLAY_ADDR         (0x7000)
+#endif
+#define GB_OVERLAY_SIZE         (0x8000 - GB_OVERLAY_ADDR)
+
+#define GB_DRIVER_MAGIC_0       'G'
+#define GB_DRIVER_MAGIC_1       'B'
+#define GB_DRIVER_VERSION       1
+#define GB_DRIVER_MAX_TYPES     8
+
+/**
+ * Services of the core given to the drivers
+ */
+typedef struct {
+    /* Map the given cartridge address (multiple of 16KB) into the virtual page at `cart_virt` */
+    void     (*map_cart_phys)(uint16_t cart_addr);
+    /* Select the given SRAM bank and map it, returns its virtual address */
+    uint8_t* (*map_sram)(uint8_t bank);
+    /* Size in KB of the cartridge RAM, from the size byte of the header */
+    uint8_t  (*ram_size)(uint8_t size_value);
+    uint8_t* cart_virt;
+} gb_core_t;
+
+typedef struct {
+    uint8_t  magic[2];
+    uint8_t  version;
+    /* Cartridge types handled by the driver, terminated by 0 if there are less than GB_DRIVER_MAX_TYPES */
+    uint8_t  types[GB_DRIVER_MAX_TYPES];
+    /* Called with the ROM bank 0 mapped, gives the number and the size of the SRAM banks */
+    void     (*probe)(const gb_core_t* core, uint8_t cart_type, uint8_t* bank_num, uint16_t* bank_size);
+    /* Called after the RAM was enabled, before the first bank is mapped */
+    void     (*init)(const gb_core_t* core, uint8_t cart_type);
+    /* Map the given SRAM bank, returns its virtual address */
+    uint8_t* (*map_sram)(const gb_core_t* core, uint8_t bank);
+} gb_driver_t;
@@ -0,0 +1,80 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+/* Define different cartridges type */
+#define MBC1_ROM            0x1
+#define MBC1_RAM            0x2
+#define MBC1_RAM_BATT       0x3
+#define MBC2_RAM_BATT       0x6
+#define ROM_RAM_BATT        0x10
+#define MBC3_RAM_BATT       0x13
+#define MBC5_ROM            0x19
+#define MBC5_RAM            0x1a
+#define MBC5_RAM_BATT       0x1b
+#define MBC5_RUMB           0x1c
+#define MBC5_RUMB_RAM       0x1d
+#define MBC5_RUMB_RAM_BATT  0x1e
+#define MBC7_SENSOR_RUMB_RAM_BATT   0x22
+#define POCKET_CAMERA       0xfc
+
+/* Cartridge header offsets, the header follows the entry point */
+#define GB_HDR_START        0x100
+#define GB_HDR_LOGO         0x104
+#define GB_HDR_TITLE        0x134
+#define GB_HDR_ROM_SIZE     0x148
+#define GB_HDR_END          0x150
+
+/**
+ * Each ROM bank is 16KB big, the ROM size byte of the header gives 32KB << n
+ */
+#define GB_ROM_BANK_SIZE        (16*1024)
+
+/**
+ * MBC1 addresses up to 2MB of ROM: 5 bits in the ROM bank register, 2 bits in the upper register.
+ * MBC1M multicarts (1MB) don't connect the bit 4 of the ROM bank register, the upper register
+ * selects the bits 4-5 of the bank number: each game starts with its own header, every 16 banks.
+ */
+#define GB_MBC1_ROM_BANKS_MAX   128
+#define GB_MBC1_UPPER_SHIFT     5
+#define GB_MBC1M_UPPER_SHIFT    4
+#define GB_MBC1M_ROM_BANKS      64
+
+/**
+ * MBC5 addresses up to 8MB of ROM: 8 bits in the register at 0x2000, the bit 8 at 0x3000.
+ * The bank 0 can also be mapped in the switchable area.
+ */
+#define GB_MBC5_ROM_BANKS_MAX   512
+
+/**
+ * Each SRAM bank in the cartridge is 8KB big
+ */
+#define GB_SRAM_BANK_SIZE       (8*1024)
+
+/**
+ * The largest SRAM, 128KB, has 16 banks
+ */
+#define GB_SRAM_BANKS_MAX       16
+
+/**
+ * MBC2 has a single bank of 512 4-bit values
+ */
+#define GB_MBC2_SRAM_SIZE       (512)
+
+/**
+ * MBC7 has a 256-byte serial EEPROM instead of an SRAM, see mbc7.h
+ */
+#define GB_MBC7_EEPROM_SIZE     (256)
+
+/**
+ * Game Boy Camera: 30 photo slots of 4KB, after the first 8KB bank. Each one contains the
+ * 128x112 2bpp image, its thumbnail and its metadata. The slot state vector, in the first bank,
+ * has one byte per slot: 0xFF when the slot is empty, the index of the photo in the album else.
+ */
+#define GB_CAMERA_SLOTS             30
+#define GB_CAMERA_STATE_OFFSET      (0x11b2)
+#define GB_CAMERA_PHOTO_SIZE        (4*1024)
+#define GB_CAMERA_SLOT_EMPTY        0xff
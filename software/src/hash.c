@@ -0,0 +1,59 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include "hash.h"
+
+/* Parameters and result of the assembly routine */
+static const uint8_t* s_data;
+static uint16_t s_len;
+static uint16_t s_sum1;
+static uint16_t s_sum2;
+
+
+static void hash_run(void) __naked
+{
+    __asm
+        push ix
+        ld hl, (_s_data)
+        ld bc, (_s_len)
+        ld de, #0
+        ld ix, #0
+        ; Loop on B (low byte of the length) then C (high byte), C is incremented when B is not 0
+        ld a, c
+        or a
+        jr z, 00001$
+        inc b
+00001$:
+        ld a, b
+        ld b, c
+        ld c, a
+00002$:
+        ld a, (hl)
+        add a, e
+        ld e, a
+        jr nc, 00003$
+        inc d
+00003$:
+        add ix, de
+        inc hl
+        djnz 00002$
+        dec c
+        jr nz, 00002$
+        ld (_s_sum1), de
+        ld (_s_sum2), ix
+        pop ix
+        ret
+    __endasm;
+}
+
+
+uint32_t hash_block(const uint8_t* data, uint16_t len)
+{
+    s_data = data;
+    s_len = len;
+    hash_run();
+    return ((uint32_t) s_sum2 << 16) | s_sum1;
+}
@@ -0,0 +1,22 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Hash of the blocks compared with the host, Fletcher-32 like: the 16-bit sum of the bytes in the
+ * lower half, the 16-bit sum of these running sums in the upper half (both modulo 65536). Any single
+ * byte change gives a different hash. A swap of two different bytes is only guaranteed to change
+ * it in blocks of up to 256 bytes: further apart, the upper half can wrap back to the same value
+ * (e.g. 0x80 and 0x00 swapped 512 bytes apart), so a whole bank hash is a sanity check, not a proof
+ * that the bank is identical. It must match `block_hash` in gbcodec.py.
+ */
+
+/**
+ * @brief Hash `len` bytes, `len` can't be 0. About 60 T-states per byte.
+ */
+uint32_t hash_block(const uint8_t* data, uint16_t len);
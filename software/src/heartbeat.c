@@ -0,0 +1,35 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include "zos_time.h"
+#include "protocol.h"
+#include "uart.h"
+#include "heartbeat.h"
+
+static uint16_t s_last = 0;
+
+
+void heartbeat_start(void)
+{
+    zos_time_t now = { 0 };
+    gettime(0, &now);
+    s_last = now.t_millis;
+}
+
+
+void heartbeat(zos_dev_t dev, uint16_t progress)
+{
+    zos_time_t now;
+
+    /* Without a clock, no heartbeat can be sent */
+    if (gettime(0, &now) != ERR_SUCCESS || (uint16_t) (now.t_millis - s_last) < HEARTBEAT_PERIOD_MS) {
+        return;
+    }
+    s_last = now.t_millis;
+
+    uint8_t frame[3] = { REPLY_HEARTBEAT, progress & 0xff, progress >> 8 };
+    uart_write_all(dev, frame, sizeof(frame));
+}
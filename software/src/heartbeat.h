@@ -0,0 +1,28 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "zos_vfs.h"
+
+/**
+ * Long local operations, which don't send anything for a while, emit heartbeat frames so that the
+ * host can tell them apart from a hang: REPLY_HEARTBEAT followed by a progress counter (16-bit
+ * little-endian), whose meaning depends on the operation. They can only be sent while the host
+ * waits for a reply, which they precede.
+ */
+#define HEARTBEAT_PERIOD_MS     500
+
+/**
+ * @brief Start the period, to call before a long operation
+ */
+void heartbeat_start(void);
+
+/**
+ * @brief Send a heartbeat frame if the period elapsed since the last one. Cheap enough to be called
+ *        once per block of the operation, it only costs a `gettime` otherwise.
+ */
+void heartbeat(zos_dev_t dev, uint16_t progress);
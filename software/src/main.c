@@ -3,29 +3,94 @@
  * SPDX-License-Identifier: CC0-1.0
  */
 
-#include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "zos_errors.h"
 #include "zos_vfs.h"
 #include "zos_sys.h"
 #include "zos_serial.h"
+#include "print.h"
+#include "gbcart.h"
+#include "protocol.h"
+#include "uart.h"
+#include "stub.h"
+#include "trace.h"
+#include "heartbeat.h"
+#include "sramtest.h"
+#include "stability.h"
+#include "hash.h"
+#include "unpack.h"
+#include "search.h"
+#include "scratch.h"
 
 /* If the standard output is the same serial driver as the one used to backup the cartridge,
  * we shall not output anything during the dump. After backing up, wait for a character before exiting. */
 #define STDOUT_IS_SERIAL    1
 
-/* Define different cartridges type */
-#define MBC1_RAM_BATT       0x3
-#define MBC2_RAM_BATT       0x6
-#define ROM_RAM_BATT        0x10
-#define MBC3_RAM_BATT       0x13
-#define MBC5_RAM_BATT       0x1b
-#define MBC5_RUMB_RAM_BATT  0x1e
+/**
+ * The Makefile builds a generic binary, supporting all the cartridge types of gbcart.h, and one binary
+ * per MBC (gbdump-mbc1.bin, ...) compiled with GB_MBC set, which only contains the code for that MBC.
+ * gbdump-core.bin doesn't contain any MBC code, it loads a driver overlay from the romdisk instead.
+ */
+#define GB_MBC_ANY          0
+#define GB_MBC_1            1
+#define GB_MBC_3RTC         3
+#define GB_MBC_5            5
+#define GB_MBC_OVERLAY      0x80
+
+#ifndef GB_MBC
+#define GB_MBC              GB_MBC_ANY
+#endif
+
+#if GB_MBC == GB_MBC_OVERLAY
+#include "overlay.h"
+#endif
+#if GB_MBC == GB_MBC_ANY
+#include "mbc7.h"
+#endif
+
+/* Check whether the code for the given MBC must be compiled in this binary */
+#define GB_MBC_HAS(mbc)     (GB_MBC == GB_MBC_ANY || GB_MBC == (mbc))
+
+/* Bits of the RAM bank register: 2 on MBC1, 3 on MBC3 (MBC30 has 8 banks), 4 on MBC5 */
+#if GB_MBC == GB_MBC_1
+#define GB_RAM_BANK_MASK    0x3
+#elif GB_MBC == GB_MBC_3RTC
+#define GB_RAM_BANK_MASK    0x7
+#else
+#define GB_RAM_BANK_MASK    0xF
+#endif
+
+#if GB_MBC == GB_MBC_ANY
+#define CART_IS_MBC1()      (cart_type <= MBC1_RAM_BATT)
+#define CART_IS_MBC5()      (cart_type >= MBC5_ROM && cart_type <= MBC5_RUMB_RAM_BATT)
+#else
+#define CART_IS_MBC1()      (GB_MBC == GB_MBC_1)
+#define CART_IS_MBC5()      (GB_MBC == GB_MBC_5)
+#endif
+
+/* The ROM can be dumped from MBC1 and MBC5 cartridges */
+#define GB_ROM_DUMP         (GB_MBC_HAS(GB_MBC_1) || GB_MBC_HAS(GB_MBC_5))
 
 /* Gameboy cartridge will be mapped at physical address 0x3f0000  */
 #define GB_PHYS_ADDR            (0x3f0000)
 
+/* Set to 1 when the PLD is programmed with pld/GBCDUMP_ALIAS.pld (`make PLD_ALIAS=1`) */
+#ifndef PLD_ALIAS
+#define PLD_ALIAS               0
+#endif
+
+#if PLD_ALIAS
+/**
+ * With the alias decode, the last 16KB page of the cartridge window contains the RAM bank register
+ * (cartridge address 0x4000) in its first 8KB and the SRAM in its last 8KB. Once mapped, switching
+ * the bank doesn't require any other mapping.
+ */
+#define GB_ALIAS_PAGE           (0xc000)
+#define GB_ALIAS_SRAM_OFFSET    (0x2000)
+#endif
+
 /**
  * The first page is the kernel, we can't touch it, the second page is the current program,
  * the third page is available and the forth page is the stack for this current program.
@@ -33,11 +98,6 @@
  */
 #define GB_CART_VIRT_ADDR       (0x8000)
 
-/**
- * Each SRAM bank in the cartridge is 8KB big
- */
-#define GB_SRAM_BANK_SIZE       (8*1024)
-
 /**
  * Pointer to the cartridge virtual address
  */
@@ -53,6 +113,27 @@ zos_dev_t uart_dev = 0;
  */
 uint16_t uart_attr = 0;
 
+/**
+ * Read timeout of the opened UART, restored after polling it during a dump. Polling is disabled
+ * when the serial driver doesn't support setting the timeout, the reads would block.
+ */
+uint16_t uart_timeout = 0;
+static uint8_t uart_poll_supported = 0;
+
+/**
+ * Set when the host asked for the event trace, sent at the end of each dump
+ */
+static uint8_t trace_requested = 0;
+
+static void trace_send(void)
+{
+#if GB_TRACE
+    if (trace_requested) {
+        trace_flush(uart_dev);
+    }
+#endif
+}
+
 /**
  * @brief Helper function to map cartridge given address into virtual page 3
  *
@@ -60,10 +141,14 @@ uint16_t uart_attr = 0;
  */
 static void map_cart_phys(uint16_t cart_addr)
 {
-    zos_err_t err = map((void*) GB_CART_VIRT_ADDR, GB_PHYS_ADDR + cart_addr);
+    const uint32_t phys = GB_PHYS_ADDR + cart_addr;
+    zos_err_t err = map((void*) GB_CART_VIRT_ADDR, phys);
+    TRACE(TRACE_MAP, phys >> 16, phys & 0xffff);
     if (err != ERR_SUCCESS) {
-        printf("Error cartridge map\n");
+        TRACE(TRACE_ERROR, err, 0);
+        print_fmt("Error cartridge map\n");
         if (uart_dev) {
+            trace_send();
             close(uart_dev);
         }
         exit(0);
@@ -72,15 +157,25 @@ static void map_cart_phys(uint16_t cart_addr)
 
 /**
  * @brief Map the given cartridge SRAM bank into virtual page 3
+ *
+ * @returns the virtual address of the SRAM bank
  */
-static void map_cart_sram(uint8_t bank)
+static uint8_t* map_cart_sram(uint8_t bank)
 {
+    TRACE(TRACE_BANK, bank, 0);
+#if PLD_ALIAS
+    /* The alias page is mapped once before the first bank, the bank register and the SRAM are both in it */
+    cart_virt[0] = bank & GB_RAM_BANK_MASK;
+    return cart_virt + GB_ALIAS_SRAM_OFFSET;
+#else
     /* To switch the bank, write to cartridge address 0x4000 */
     map_cart_phys(0x4000);
-    /* Only keep the lower 4 bits */
-    cart_virt[0] = bank & 0xF;
+    /* Only keep the bits of the bank register */
+    cart_virt[0] = bank & GB_RAM_BANK_MASK;
     /* SRAM bank was mapped in the cartridge itself! Map the SRAM into the virtual page */
     map_cart_phys(0x8000);
+    return cart_virt;
+#endif
 }
 
 
@@ -112,33 +207,824 @@ uint8_t cartridge_RAM_size(uint8_t size_value)
     return size;
 }
 
-static void wait_for_host(uint8_t bank_num, uint16_t bank_size)
+#if GB_MBC == GB_MBC_OVERLAY
+/**
+ * Services given to the driver overlay
+ */
+static const gb_core_t s_core = {
+    map_cart_phys,
+    map_cart_sram,
+    cartridge_RAM_size,
+    (uint8_t*) GB_CART_VIRT_ADDR
+};
+#endif
+
+/**
+ * Cartridge type and its SRAM layout, read from the header
+ */
+static uint8_t cart_type = 0;
+static uint8_t bank_num = 0;
+static uint16_t bank_size = GB_SRAM_BANK_SIZE;
+
+#if GB_MBC == GB_MBC_OVERLAY
+static const gb_driver_t* driver = NULL;
+#endif
+
+static uint8_t wait_for_command(void)
 {
     zos_err_t err;
     uint16_t size = 0;
-    char msg[4] = { 0 };
+    uint8_t cmd = 0;
 
-    printf("Ready to send, start the dump script on the host computer\n");
     while (1) {
         /* Wait for a message from the host */
         size = 1;
-        err = read(uart_dev, msg, &size);
+        err = read(uart_dev, &cmd, &size);
+
+        if (err == ERR_SUCCESS && size == 1 &&
+            (cmd == CMD_DUMP || cmd == CMD_RESTORE || cmd == CMD_RESTORE_PACKED || cmd == CMD_RESTORE_DELTA || cmd == CMD_CAMERA ||
+             cmd == CMD_ROM || cmd == CMD_SEARCH || cmd == CMD_WATCH || cmd == CMD_SRAM_TEST || cmd == CMD_STABILITY || cmd == CMD_RESIDENT || cmd == CMD_UPLOAD ||
+             cmd == CMD_TRACE || cmd == CMD_QUIT)) {
+            return cmd;
+        }
+        print_fmt("Invalid message from the host, please retry\n");
+    }
+}
+
+static void send_reply(uint8_t reply, uint8_t value)
+{
+    uint8_t msg[2] = { reply, value };
+    uint16_t size = 2;
+    write(uart_dev, msg, &size);
+}
+
+/**
+ * @brief Send the number of banks and the bank size, with REPLY_INFO or REPLY_INFO16
+ */
+static void send_info(uint8_t reply, uint16_t num, uint16_t bank_bytes)
+{
+    uint8_t msg[5];
+    uint16_t size = 0;
+    msg[size++] = reply;
+    msg[size++] = num & 0xff;
+    if (reply == REPLY_INFO16) {
+        msg[size++] = num >> 8;
+    }
+    msg[size++] = bank_bytes & 0xff;
+    msg[size++] = bank_bytes >> 8;
+    write(uart_dev, msg, &size);
+}
+
+/**
+ * @brief Enable the cartridge RAM and set up the MBC before accessing the SRAM banks
+ */
+static void cart_enable(void)
+{
+    /* Enable the RAM: the first 8KB of the cartridge can be used to enable the cartridge RAM by writing 0xA to it.
+     * The page may still contain the SRAM of a previous dump, map the beginning of the cartridge again. */
+    map_cart_phys(0);
+    cart_virt[0] = 0xA;
+
+    /* Enable RAM banking from "Banking Mode Select" register.
+     * This register can be written to when writing cartridge's address 6000–7FFF. Let's map this area to the virtual page.
+     *
+     * NOTE: We can only map physical pages multiple of 16KB! The solution is to map 0x4000 and write at address 0x2000.
+     */
+#if GB_MBC == GB_MBC_OVERLAY
+    driver->init(&s_core, cart_type);
+#elif GB_MBC == GB_MBC_1
+    map_cart_phys(0x4000);
+    cart_virt[0x2000] = 1;
+#elif GB_MBC == GB_MBC_ANY
+    if (CART_IS_MBC1()) {
+        /* MBC1 Only */
+        map_cart_phys(0x4000);
+        /* We need to write 1 to it to enable RAM banking (0 disables banking) */
+        cart_virt[0x2000] = 1;
+    } else if (cart_type == MBC7_SENSOR_RUMB_RAM_BATT) {
+        /* MBC7 has a second RAM enable register, at 0x4000 */
+        map_cart_phys(0x4000);
+        cart_virt[0] = MBC7_RAM_ENABLE2;
+    }
+#endif
+
+#if PLD_ALIAS
+    map_cart_phys(GB_ALIAS_PAGE);
+#endif
+}
+
+#if GB_MBC == GB_MBC_ANY
+/**
+ * @brief Map the RAM area of an MBC7 cartridge, which contains the EEPROM register. Its bank
+ *        register must not be written, it is the second RAM enable.
+ */
+static uint8_t* map_mbc7_reg(void)
+{
+#if PLD_ALIAS
+    return cart_virt + GB_ALIAS_SRAM_OFFSET + MBC7_REG_OFFSET;
+#else
+    map_cart_phys(0x8000);
+    return cart_virt + MBC7_REG_OFFSET;
+#endif
+}
+#endif
+
+/**
+ * @brief Map the given bank in the virtual page. When the cartridge has no memory-mapped SRAM,
+ *        such as MBC7, a buffer is returned instead, filled with the save content if `load` is set.
+ *
+ * @returns the address of the bank content
+ */
+static uint8_t* map_bank(uint8_t bank, uint8_t load)
+{
+    (void) load;
+#if GB_MBC == GB_MBC_OVERLAY
+    return driver->map_sram(&s_core, bank);
+#else
+#if GB_MBC == GB_MBC_ANY
+    if (cart_type == MBC7_SENSOR_RUMB_RAM_BATT) {
+        return load ? mbc7_eeprom_read(map_mbc7_reg()) : mbc7_eeprom_buffer();
+    }
+#endif
+    return map_cart_sram(bank);
+#endif
+}
+
+/**
+ * @brief Write back the content of a bank returned by `map_bank`, when it is a buffer
+ */
+static zos_err_t commit_bank(void)
+{
+#if GB_MBC == GB_MBC_ANY
+    if (cart_type == MBC7_SENSOR_RUMB_RAM_BATT && mbc7_eeprom_write(map_mbc7_reg()) != 0) {
+        return ERR_FAILURE;
+    }
+#endif
+    return ERR_SUCCESS;
+}
+
+/**
+ * @brief Disable the cartridge RAM, once the dump is over or aborted
+ */
+static void cart_disable(void)
+{
+    map_cart_phys(0);
+    cart_virt[0] = 0;
+}
+
+/**
+ * @brief Make the reads on the UART return immediately when `nonblocking` is set, restore the
+ *        original timeout else.
+ */
+static void uart_set_nonblocking(uint8_t nonblocking)
+{
+    if (uart_poll_supported) {
+        ioctl(uart_dev, SERIAL_CMD_SET_TIMEOUT, (void*) (nonblocking ? 0 : uart_timeout));
+    }
+}
+
+/**
+ * @brief Check, between two blocks, whether the host sent a control byte. The UART must be in
+ *        non-blocking mode. After CMD_PAUSE, wait for CMD_RESUME or CMD_ABORT.
+ *
+ * @returns 1 if the host aborted the dump, 0 else.
+ */
+static uint8_t poll_control(void)
+{
+    uint8_t cmd = 0;
+    uint16_t size = 1;
+
+    if (!uart_poll_supported || read(uart_dev, &cmd, &size) != ERR_SUCCESS || size == 0) {
+        return 0;
+    }
+    TRACE(TRACE_CMD, cmd, 0);
+    if (cmd == CMD_PAUSE) {
+        uart_set_nonblocking(0);
+        do {
+            size = 1;
+            if (read(uart_dev, &cmd, &size) != ERR_SUCCESS) {
+                cmd = CMD_ABORT;
+            }
+        } while (size == 0 || (cmd != CMD_RESUME && cmd != CMD_ABORT));
+        TRACE(TRACE_CMD, cmd, 0);
+        uart_set_nonblocking(1);
+    }
+    return cmd == CMD_ABORT;
+}
+
+/**
+ * @brief Send all the SRAM banks to the host, through the loaded stub if any. Between two banks,
+ *        the host can pause or abort the dump.
+ */
+static zos_err_t send_banks(void)
+{
+    zos_err_t err = ERR_SUCCESS;
+    uint16_t size;
+    gb_stub_t* stub = stub_get();
+
+    uart_set_nonblocking(1);
+    /* Finally, let's use our own function to map the cartridge RAM. Let's hardcode the number of banks for the moment */
+    for (uint8_t bank = 0; bank < bank_num; bank++) {
+        if (poll_control()) {
+            break;
+        }
+        /* In the case where #SER0 is the same driver as the STDOUT, we shall not write anything to STDOUT while backup is on-going */
+#if !STDOUT_IS_SERIAL
+        print_fmt("Backing up bank %d...\n", bank);
+#endif
+        uint8_t* sram = map_bank(bank, 1);
+        size = bank_size;
+        if (stub != NULL) {
+            /* Let the stub process the bank, it gives back the data to send, preceded by its size */
+            stub->data = sram;
+            stub->size = size;
+            stub->bank = bank;
+            stub_run();
+            sram = stub->data;
+            size = 2;
+            err = write(uart_dev, &stub->size, &size);
+            if (err != ERR_SUCCESS) {
+                break;
+            }
+            size = stub->size;
+        }
+        /* The SRAM 8KB bank is now mapped in the virtual page 3, send the content to the UART. */
+        err = write(uart_dev, sram, &size);
+        TRACE(TRACE_UART_WRITE, err, size);
+        if (err != ERR_SUCCESS) {
+            break;
+        }
+    }
+    uart_set_nonblocking(0);
+    return err;
+}
 
-        /* Make sure it is '!' */
-        if (err != ERR_SUCCESS || msg[0] != '!') {
-            printf("Invalid message from the host, please retry\n");
+#if GB_ROM_DUMP
+/**
+ * Number of 16KB ROM banks, 0 when the ROM of the cartridge can't be dumped
+ */
+static uint16_t rom_banks = 0;
+
+/**
+ * @brief Write an MBC register, located in the first 32KB of the cartridge address space.
+ *        The page containing it is left mapped.
+ */
+static void cart_write_reg(uint16_t addr, uint8_t value)
+{
+    map_cart_phys(addr & 0x4000);
+    cart_virt[addr & 0x3fff] = value;
+}
+
+#if GB_MBC_HAS(GB_MBC_1)
+/**
+ * Bit of the bank number selected by the MBC1 upper register
+ */
+static uint8_t mbc1_upper_shift = GB_MBC1_UPPER_SHIFT;
+
+/**
+ * @brief Get the ROM size of an MBC1 cartridge and check whether it is an MBC1M multicart, whose
+ *        header only gives the size of the menu. The Nintendo logo is looked for in the bank 0x10,
+ *        mapped in 0x0000-0x3FFF in mode 1. On a regular MBC1, the bank 0x20 is mapped instead, or
+ *        the bank 0 again when the ROM is smaller than 1MB: its header is then the same.
+ */
+static void mbc1_probe_rom(uint8_t size)
+{
+    uint8_t header[GB_HDR_END - GB_HDR_LOGO];
+
+    rom_banks = size < 6 ? 2 << size : GB_MBC1_ROM_BANKS_MAX;
+    memcpy(header, cart_virt + GB_HDR_LOGO, sizeof(header));
+
+    cart_write_reg(0x4000, 1);
+    cart_write_reg(0x6000, 1);
+    map_cart_phys(0);
+    const uint8_t* other = cart_virt + GB_HDR_LOGO;
+    if (memcmp(header, other, GB_HDR_TITLE - GB_HDR_LOGO) == 0 &&
+        memcmp(header, other, sizeof(header)) != 0) {
+        rom_banks = GB_MBC1M_ROM_BANKS;
+        mbc1_upper_shift = GB_MBC1M_UPPER_SHIFT;
+    }
+    cart_write_reg(0x4000, 0);
+    cart_write_reg(0x6000, 0);
+    map_cart_phys(0);
+}
+#endif
+
+/**
+ * @brief Get the number of ROM banks from the header, the ROM bank 0 must be mapped
+ */
+static void rom_probe(void)
+{
+    const uint8_t size = cart_virt[GB_HDR_ROM_SIZE];
+#if GB_MBC_HAS(GB_MBC_1)
+    if (CART_IS_MBC1()) {
+        mbc1_probe_rom(size);
+        return;
+    }
+#endif
+#if GB_MBC_HAS(GB_MBC_5)
+    if (CART_IS_MBC5()) {
+        rom_banks = size < 8 ? 2 << size : GB_MBC5_ROM_BANKS_MAX;
+    }
+#endif
+}
+
+/**
+ * @brief Map the given ROM bank in the virtual page. The banks are mapped in order, from 0, so the
+ *        registers holding the upper bits of the bank number are only written when they change.
+ *
+ * MBC1: the banks multiple of 0x20 (0x10 on MBC1M) can't be mapped in the switchable area
+ * 0x4000-0x7FFF, in mode 1 they are mapped in 0x0000-0x3FFF by the upper register instead.
+ * MBC5: the bit 8 of the bank number is in its own register, at 0x3000.
+ */
+static void map_rom_bank(uint16_t bank)
+{
+#if GB_MBC_HAS(GB_MBC_1)
+    if (CART_IS_MBC1()) {
+        const uint8_t low_mask = (1 << mbc1_upper_shift) - 1;
+        if ((bank & low_mask) == 0) {
+            cart_write_reg(0x4000, bank >> mbc1_upper_shift);
+            map_cart_phys(0);
+        } else {
+            cart_write_reg(0x2000, bank & low_mask);
+            map_cart_phys(0x4000);
+        }
+        return;
+    }
+#endif
+    if (bank == 0) {
+        map_cart_phys(0);
+        return;
+    }
+    if ((bank & 0xff) == 0) {
+        cart_write_reg(0x3000, bank >> 8);
+    }
+    cart_write_reg(0x2000, bank & 0xff);
+    map_cart_phys(0x4000);
+}
+
+/**
+ * @brief Prepare the banking registers before mapping ROM banks with `map_rom_bank`
+ */
+static void rom_banking_start(void)
+{
+    if (CART_IS_MBC1()) {
+        cart_write_reg(0x6000, 1);
+    } else {
+        /* map_rom_bank only writes the bit 8 when it changes, it may have been left set by an
+         * interrupted dump */
+        cart_write_reg(0x3000, 0);
+    }
+}
+
+/**
+ * @brief Put the banking registers back in their power-on state, the MBC1 SRAM banking mode is
+ *        set again by cart_enable
+ */
+static void rom_banking_end(void)
+{
+    if (CART_IS_MBC1()) {
+        cart_write_reg(0x4000, 0);
+        cart_write_reg(0x6000, 0);
+    } else {
+        cart_write_reg(0x3000, 0);
+    }
+    cart_write_reg(0x2000, 1);
+}
+
+/**
+ * @brief Send all the ROM banks, in order. Between two banks, the host can pause or abort the dump.
+ */
+static zos_err_t send_rom(void)
+{
+    zos_err_t err = ERR_SUCCESS;
+
+    uart_set_nonblocking(1);
+    rom_banking_start();
+    for (uint16_t bank = 0; bank < rom_banks; bank++) {
+        if (poll_control()) {
+            break;
+        }
+        map_rom_bank(bank);
+        err = uart_write_all(uart_dev, cart_virt, GB_ROM_BANK_SIZE);
+        TRACE(TRACE_UART_WRITE, err, GB_ROM_BANK_SIZE);
+        if (err != ERR_SUCCESS) {
+            break;
+        }
+    }
+    rom_banking_end();
+    uart_set_nonblocking(0);
+    return err;
+}
+#endif
+
+#if GB_MBC == GB_MBC_ANY
+/**
+ * @brief Send the occupied photo slots of a Game Boy Camera, preceded by the slot state vector
+ */
+static zos_err_t send_camera_photos(void)
+{
+    uint8_t state[1 + GB_CAMERA_SLOTS];
+    zos_err_t err;
+
+    const uint8_t* sram = map_cart_sram(0);
+    state[0] = REPLY_OK;
+    for (uint8_t slot = 0; slot < GB_CAMERA_SLOTS; slot++) {
+        state[1 + slot] = sram[GB_CAMERA_STATE_OFFSET + slot];
+    }
+    err = uart_write_all(uart_dev, state, sizeof(state));
+
+    for (uint8_t slot = 0; slot < GB_CAMERA_SLOTS && err == ERR_SUCCESS; slot++) {
+        if (state[1 + slot] == GB_CAMERA_SLOT_EMPTY) {
             continue;
         }
+        /* Two photos per bank, starting at bank 1 */
+        sram = map_cart_sram(1 + (slot >> 1));
+        err = uart_write_all(uart_dev, sram + (slot & 1) * GB_CAMERA_PHOTO_SIZE, GB_CAMERA_PHOTO_SIZE);
+        TRACE(TRACE_UART_WRITE, err, GB_CAMERA_PHOTO_SIZE);
+    }
+    return err;
+}
+#endif
+
+/**
+ * @brief Test all the SRAM banks, without losing their content, and send the result of each bank.
+ *        A heartbeat, giving the bank being tested, is sent between two blocks.
+ */
+static zos_err_t test_sram(void)
+{
+    sram_test_result_t results[GB_SRAM_BANKS_MAX];
+    /* MBC2 RAM only has the lower 4 bits of each byte */
+    const uint8_t mask = cart_type == MBC2_RAM_BATT ? 0x0f : 0xff;
+
+    heartbeat_start();
+    for (uint8_t bank = 0; bank < bank_num; bank++) {
+        sram_test_result_t* result = &results[bank];
+        uint8_t* sram = map_bank(bank, 0);
+        sram_test_reset(result);
+        for (uint16_t offset = 0; offset < bank_size; offset += SRAM_TEST_BLOCK_SIZE) {
+            const uint16_t left = bank_size - offset;
+            heartbeat(uart_dev, bank);
+            sram_test_block(sram + offset, left < SRAM_TEST_BLOCK_SIZE ? left : SRAM_TEST_BLOCK_SIZE,
+                            mask, offset, result);
+        }
+        if (result->errors != 0) {
+            TRACE(TRACE_ERROR, bank, result->errors);
+        }
+    }
+
+    send_reply(REPLY_OK, bank_num);
+    return uart_write_all(uart_dev, results, bank_num * sizeof(sram_test_result_t));
+}
 
-        /* Send the number of banks and the bank size */
-        msg[0] = '=';
-        msg[1] = bank_num;
-        msg[2] = bank_size & 0xff;
-        msg[3] = bank_size >> 8;
-        size = 4;
-        write(uart_dev, msg, &size);
-        break;
+/**
+ * @brief Read a sample of ROM and SRAM blocks `passes` times and send, for each block, the number
+ *        of passes that didn't read the same content as the first one. The ROM blocks cover the
+ *        header and each 4KB of the first 32KB, with the power-on banking. A heartbeat, giving the
+ *        current pass, is sent between two passes.
+ */
+static zos_err_t scan_stability(uint8_t passes)
+{
+    stability_block_t blocks[STABILITY_BLOCKS_MAX];
+    uint32_t hashes[STABILITY_BLOCKS_MAX];
+    uint8_t count = 0;
+
+    for (uint16_t addr = 0; addr < 0x8000; addr += 0x1000) {
+        blocks[count].kind = STABILITY_ROM;
+        blocks[count].bank = 0;
+        /* The first block of the ROM is the header */
+        blocks[count].offset = addr ? addr : GB_HDR_START;
+        count++;
+    }
+    /* SRAM: beginning and middle of the first bank, end of the last one. The MBC2 RAM upper bits
+     * are not connected and the MBC7 RAM area is the EEPROM register, they can't be compared. */
+    if (bank_num != 0 && cart_type != MBC2_RAM_BATT && cart_type != MBC7_SENSOR_RUMB_RAM_BATT) {
+        const uint8_t last = bank_num - 1;
+        for (uint8_t i = 0; i < 3; i++) {
+            blocks[count].kind = STABILITY_SRAM;
+            blocks[count].bank = i < 2 ? 0 : last;
+            blocks[count].offset = i == 0 ? 0 : i == 1 ? bank_size / 2 : bank_size - STABILITY_BLOCK_SIZE;
+            count++;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        blocks[i].unstable = 0;
     }
+
+    heartbeat_start();
+    for (uint8_t pass = 0; pass < passes; pass++) {
+        heartbeat(uart_dev, pass);
+        for (uint8_t i = 0; i < count; i++) {
+            stability_block_t* block = &blocks[i];
+            const uint8_t* data;
+            if (block->kind == STABILITY_ROM) {
+                map_cart_phys(block->offset & 0x4000);
+                data = cart_virt + (block->offset & 0x3fff);
+            } else {
+#if PLD_ALIAS
+                /* The ROM blocks replaced the alias page */
+                map_cart_phys(GB_ALIAS_PAGE);
+#endif
+                data = map_bank(block->bank, 0) + block->offset;
+            }
+            const uint32_t hash = hash_block(data, STABILITY_BLOCK_SIZE);
+            if (pass == 0) {
+                hashes[i] = hash;
+            } else if (hash != hashes[i]) {
+                block->unstable++;
+            }
+        }
+    }
+
+    send_reply(REPLY_OK, count);
+    return uart_write_all(uart_dev, blocks, count * sizeof(stability_block_t));
+}
+
+_Static_assert(SEARCH_PATTERNS_MAX * sizeof(search_pattern_t) + sizeof(search_result_t) <= SCRATCH_SIZE,
+               "The search patterns and result must fit in the scratch area");
+
+/**
+ * @brief Receive the search patterns and look for them in all the ROM or SRAM banks, then send the
+ *        matches. A heartbeat, giving the bank being searched, is sent between two banks.
+ */
+static zos_err_t search_cart(void)
+{
+    /* The patterns are followed by the result in the scratch area */
+    search_pattern_t* const patterns = (search_pattern_t*) scratch_buffer();
+    search_result_t* const result = (search_result_t*) (patterns + SEARCH_PATTERNS_MAX);
+    uint8_t params[2];
+    uint8_t invalid = 0;
+
+    /* Target and number of patterns, then each pattern as a fixed-size record: its length, its
+     * bytes and its masks, padded to SEARCH_PATTERN_MAX. All the records are read, even invalid
+     * ones, so that none of their bytes is taken as a command. */
+    zos_err_t err = uart_read_all(uart_dev, params, sizeof(params));
+    const uint8_t count = params[1];
+    if (count == 0 || count > SEARCH_PATTERNS_MAX) {
+        invalid = 1;
+    }
+    for (uint8_t i = 0; i < count && err == ERR_SUCCESS; i++) {
+        /* The records past the maximum are read in the last one, then ignored */
+        search_pattern_t* pattern = &patterns[i < SEARCH_PATTERNS_MAX ? i : SEARCH_PATTERNS_MAX - 1];
+        err = uart_read_all(uart_dev, &pattern->len, 1);
+        if (err == ERR_SUCCESS) {
+            err = uart_read_all(uart_dev, pattern->bytes, SEARCH_PATTERN_MAX);
+        }
+        if (err == ERR_SUCCESS) {
+            err = uart_read_all(uart_dev, pattern->mask, SEARCH_PATTERN_MAX);
+        }
+        if (pattern->len == 0 || pattern->len > SEARCH_PATTERN_MAX) {
+            invalid = 1;
+        } else {
+            search_prepare(pattern);
+        }
+    }
+    if (err != ERR_SUCCESS) {
+        return err;
+    }
+
+    result->count = 0;
+    heartbeat_start();
+    if (params[0] == SEARCH_ROM && !invalid) {
+#if GB_ROM_DUMP
+        if (rom_banks == 0) {
+            invalid = 1;
+        } else {
+            rom_banking_start();
+            for (uint16_t bank = 0; bank < rom_banks; bank++) {
+                heartbeat(uart_dev, bank);
+                map_rom_bank(bank);
+                search_block(cart_virt, GB_ROM_BANK_SIZE, bank, patterns, count, result);
+            }
+            rom_banking_end();
+        }
+#else
+        invalid = 1;
+#endif
+    } else if (params[0] == SEARCH_SRAM && !invalid && bank_num != 0) {
+        cart_enable();
+        for (uint8_t bank = 0; bank < bank_num; bank++) {
+            heartbeat(uart_dev, bank);
+            search_block(map_bank(bank, 1), bank_size, bank, patterns, count, result);
+        }
+        cart_disable();
+    } else {
+        invalid = 1;
+    }
+
+    if (invalid) {
+        send_reply(REPLY_ERROR, 0);
+        return ERR_SUCCESS;
+    }
+    send_reply(REPLY_OK, result->count);
+    return uart_write_all(uart_dev, result->matches, result->count * sizeof(search_match_t));
+}
+
+_Static_assert(GB_SRAM_BANKS_MAX * (GB_SRAM_BANK_SIZE / DELTA_BLOCK_SIZE) * sizeof(uint32_t) <= SCRATCH_SIZE,
+               "The hashes of the SRAM watch must fit in the scratch area");
+
+/**
+ * @brief Hash all the SRAM blocks again and again and send the ones whose hash changed since the
+ *        previous pass, all of them on the first pass, until the host aborts the watch. The
+ *        hashes of the previous pass are kept in memory. A heartbeat, giving the pass number, is
+ *        sent between two passes.
+ */
+static zos_err_t watch_sram(void)
+{
+    /* Hashes of the previous pass, one per block of all the banks */
+    uint32_t* const hashes = (uint32_t*) scratch_buffer();
+    const uint8_t blocks = bank_size / DELTA_BLOCK_SIZE;
+    uint8_t header[3] = { REPLY_BLOCK, 0, 0 };
+    uint8_t first = 1;
+    zos_err_t err = ERR_SUCCESS;
+
+    uart_set_nonblocking(1);
+    heartbeat_start();
+    for (uint16_t pass = 0; err == ERR_SUCCESS && !poll_control(); pass++) {
+        uint32_t* previous = hashes;
+        heartbeat(uart_dev, pass);
+        for (uint8_t bank = 0; bank < bank_num && err == ERR_SUCCESS; bank++) {
+            const uint8_t* data = map_bank(bank, 1);
+            for (uint8_t block = 0; block < blocks; block++) {
+                const uint32_t hash = hash_block(data, DELTA_BLOCK_SIZE);
+                if (first || hash != *previous) {
+                    *previous = hash;
+                    header[1] = bank;
+                    header[2] = block;
+                    err = uart_write_all(uart_dev, header, sizeof(header));
+                    if (err == ERR_SUCCESS) {
+                        err = uart_write_all(uart_dev, data, DELTA_BLOCK_SIZE);
+                    }
+                    TRACE(TRACE_UART_WRITE, err, DELTA_BLOCK_SIZE);
+                    if (err != ERR_SUCCESS) {
+                        break;
+                    }
+                }
+                previous++;
+                data += DELTA_BLOCK_SIZE;
+            }
+        }
+        first = 0;
+    }
+    uart_set_nonblocking(0);
+    if (err == ERR_SUCCESS) {
+        send_reply(REPLY_OK, 0);
+    }
+    return err;
+}
+
+/**
+ * @brief Receive the content of all the SRAM banks from the host and write it to the cartridge
+ */
+static zos_err_t receive_banks(void)
+{
+    zos_err_t err = ERR_SUCCESS;
+
+    for (uint8_t bank = 0; bank < bank_num && err == ERR_SUCCESS; bank++) {
+        uint8_t* sram = map_bank(bank, 0);
+        /* The host waits for this reply to send the bank, nothing can be received in between */
+        send_reply(REPLY_READY, bank);
+        /* Like the dump, the data goes straight to the mapped SRAM */
+        err = uart_read_all(uart_dev, sram, bank_size);
+        TRACE(TRACE_UART_READ, err, bank_size);
+        if (err == ERR_SUCCESS) {
+            err = commit_bank();
+        }
+    }
+    return err;
+}
+
+_Static_assert(UNPACK_FRAME_SIZE <= SCRATCH_SIZE, "The compressed frames must fit in the scratch area");
+
+/**
+ * @brief Receive the content of all the SRAM banks as frames, raw or compressed, and decompress them
+ *        straight into the mapped bank. Each bank is then read back and checked against the hash
+ *        sent by the host.
+ */
+static zos_err_t receive_packed_banks(void)
+{
+    zos_err_t err = ERR_SUCCESS;
+    uint8_t header[PACK_HEADER_SIZE];
+
+    for (uint8_t bank = 0; bank < bank_num && err == ERR_SUCCESS; bank++) {
+        uint8_t* const start = map_bank(bank, 0);
+        uint8_t* out = start;
+        while (1) {
+            /* Nothing can be received while decompressing, the host waits for this reply to send
+             * the next frame */
+            send_reply(REPLY_READY, bank);
+            err = uart_read_all(uart_dev, header, sizeof(header));
+            if (err != ERR_SUCCESS || header[0] == PACK_END) {
+                break;
+            }
+            const uint16_t size = header[1] | (header[2] << 8);
+            const uint16_t decoded = header[3] | (header[4] << 8);
+            const uint16_t left = bank_size - (uint16_t) (out - start);
+            if (header[0] > PACK_LZ || decoded > left ||
+                (header[0] == PACK_RAW ? size != decoded : size == 0 || size > UNPACK_FRAME_SIZE)) {
+                err = ERR_INVALID_PARAMETER;
+                break;
+            }
+            if (header[0] == PACK_RAW) {
+                err = uart_read_all(uart_dev, out, size);
+            } else {
+                uint8_t* frame = scratch_buffer();
+                err = uart_read_all(uart_dev, frame, size);
+                if (err == ERR_SUCCESS) {
+                    /* The decoders stop before writing past the declared size */
+                    uint8_t* end = header[0] == PACK_RLE ? unpack_rle(frame, size, out, out + decoded) :
+                                                           unpack_lz(frame, size, out, out + decoded);
+                    if (end != out + decoded) {
+                        err = ERR_INVALID_PARAMETER;
+                    }
+                }
+            }
+            TRACE(TRACE_UART_READ, err, size);
+            if (err != ERR_SUCCESS) {
+                break;
+            }
+            out += decoded;
+        }
+        if (err != ERR_SUCCESS) {
+            break;
+        }
+        if (out != start + bank_size) {
+            err = ERR_INVALID_PARAMETER;
+            break;
+        }
+        err = commit_bank();
+        /* The end frame contains the hash of the bank, compare it to what the cartridge gives back */
+        if (err == ERR_SUCCESS) {
+            uint32_t expected;
+            memcpy(&expected, header + 1, sizeof(expected));
+            if (hash_block(map_bank(bank, 1), bank_size) != expected) {
+                err = ERR_FAILURE;
+            }
+        }
+    }
+    return err;
+}
+
+/**
+ * @brief Send the hash of each block of the SRAM, then receive the blocks that differ on the host
+ *        side and write them. Each block is read back and checked against the hash sent with it.
+ *        The host can also read blocks, to synchronise the save both ways.
+ */
+static zos_err_t receive_delta_blocks(void)
+{
+    zos_err_t err = ERR_SUCCESS;
+    const uint8_t blocks = bank_size / DELTA_BLOCK_SIZE;
+    uint8_t header[DELTA_HEADER_SIZE];
+    uint32_t hashes[GB_SRAM_BANK_SIZE / DELTA_BLOCK_SIZE];
+
+    for (uint8_t bank = 0; bank < bank_num && err == ERR_SUCCESS; bank++) {
+        const uint8_t* data = map_bank(bank, 1);
+        for (uint8_t i = 0; i < blocks; i++) {
+            hashes[i] = hash_block(data, DELTA_BLOCK_SIZE);
+            data += DELTA_BLOCK_SIZE;
+        }
+        err = uart_write_all(uart_dev, hashes, blocks * sizeof(uint32_t));
+        TRACE(TRACE_UART_WRITE, err, blocks * sizeof(uint32_t));
+    }
+
+    while (err == ERR_SUCCESS) {
+        /* Like the compressed restore, the host waits for this reply before sending a block */
+        send_reply(REPLY_READY, 0);
+        err = uart_read_all(uart_dev, header, sizeof(header));
+        if (err != ERR_SUCCESS || header[0] == DELTA_END) {
+            break;
+        }
+        const uint8_t bank = header[0] & ~DELTA_READ;
+        if (bank >= bank_num || header[1] >= blocks) {
+            err = ERR_INVALID_PARAMETER;
+            break;
+        }
+        if (header[0] & DELTA_READ) {
+            const uint8_t reply[3] = { REPLY_BLOCK, bank, header[1] };
+            err = uart_write_all(uart_dev, reply, sizeof(reply));
+            if (err == ERR_SUCCESS) {
+                err = uart_write_all(uart_dev, map_bank(bank, 1) + header[1] * DELTA_BLOCK_SIZE,
+                                     DELTA_BLOCK_SIZE);
+            }
+            TRACE(TRACE_UART_WRITE, err, DELTA_BLOCK_SIZE);
+            continue;
+        }
+        /* A buffer returned for the bank must hold the rest of the save, load it */
+        uint8_t* block = map_bank(bank, 1) + header[1] * DELTA_BLOCK_SIZE;
+        err = uart_read_all(uart_dev, block, DELTA_BLOCK_SIZE);
+        TRACE(TRACE_UART_READ, err, DELTA_BLOCK_SIZE);
+        if (err == ERR_SUCCESS) {
+            err = commit_bank();
+        }
+        if (err == ERR_SUCCESS) {
+            uint32_t expected;
+            memcpy(&expected, header + 2, sizeof(expected));
+            block = map_bank(bank, 1) + header[1] * DELTA_BLOCK_SIZE;
+            if (hash_block(block, DELTA_BLOCK_SIZE) != expected) {
+                err = ERR_FAILURE;
+            }
+        }
+    }
+    return err;
 }
 
 int main (void)
@@ -148,7 +1034,7 @@ int main (void)
     /* Open the serial driver to send the data to */
     uart_dev = open("#SER0", O_WRONLY);
     if (uart_dev < 0) {
-        printf("Error opening serial driver\n");
+        print_fmt("Error opening serial driver\n");
         exit(0);
     }
 
@@ -163,79 +1049,269 @@ int main (void)
 
     /* Determine the size and number of the RAM banks thanks to the cartridge type, located at offset
      * 0x147 of the ROM. */
-    uint8_t bank_num = 0;
-    uint16_t bank_size = GB_SRAM_BANK_SIZE;
-    const uint8_t cart_type = cart_virt[0x147];
+    cart_type = cart_virt[0x147];
 
     /* Previous "write" didn't output a newline, output it here before the string */
-    printf("\nCartridge type: 0x%hx\n", cart_type);
+    print_fmt("\nCartridge type: 0x%x\n", cart_type);
+#if GB_MBC == GB_MBC_OVERLAY
+    driver = overlay_load(cart_type);
+    if (driver == NULL) {
+        print_fmt("No driver overlay for this cart type, exiting...\n");
+        goto err_close_exit;
+    }
+    /* The overlay was read from the romdisk, the ROM bank 0 is still mapped */
+    driver->probe(&s_core, cart_type, &bank_num, &bank_size);
+    print_fmt("Cartridge RAM size: %u B x %d\n", bank_size, bank_num);
+#else
     switch (cart_type) {
+#if GB_MBC_HAS(GB_MBC_1)
+        case MBC1_ROM:
+        case MBC1_RAM:
         case MBC1_RAM_BATT:
+#endif
+#if GB_MBC_HAS(GB_MBC_3RTC)
         case ROM_RAM_BATT:
         case MBC3_RAM_BATT:
+#endif
+#if GB_MBC_HAS(GB_MBC_5)
+        case MBC5_ROM:
+        case MBC5_RAM:
         case MBC5_RAM_BATT:
+        case MBC5_RUMB:
+        case MBC5_RUMB_RAM:
         case MBC5_RUMB_RAM_BATT:
+#endif
             /* Cartridge RAM size pointer, located at offset 0x149 of the ROM. */
             size = cartridge_RAM_size(cart_virt[0x149]);
             bank_num = size >> 3;
-            printf("Cartridge RAM size: %d KB\n", size);
+            print_fmt("Cartridge RAM size: %d KB\n", size);
+#if GB_ROM_DUMP
+            rom_probe();
+            if (rom_banks != 0) {
+                print_fmt("Cartridge ROM size: %u KB%s\n", rom_banks << 4,
+#if GB_MBC_HAS(GB_MBC_1)
+                          mbc1_upper_shift == GB_MBC1M_UPPER_SHIFT ? ", MBC1M multicart" :
+#endif
+                          "");
+            }
+#endif
             break;
+#if GB_MBC == GB_MBC_ANY
         case MBC2_RAM_BATT:
-            bank_size = 512;
+            bank_size = GB_MBC2_SRAM_SIZE;
             bank_num = 1;
-            printf("Cartridge RAM size: %d B\n", bank_size);
+            print_fmt("Cartridge RAM size: %d B\n", bank_size);
             break;
+        case POCKET_CAMERA:
+            /* 16 banks, the bank register also selects the sensor registers with bit 4 */
+            size = cartridge_RAM_size(cart_virt[0x149]);
+            bank_num = size >> 3;
+            print_fmt("Cartridge RAM size: %d KB\n", size);
+            break;
+        case MBC7_SENSOR_RUMB_RAM_BATT:
+            bank_size = GB_MBC7_EEPROM_SIZE;
+            bank_num = 1;
+            print_fmt("Cartridge EEPROM size: %d B\n", bank_size);
+            break;
+#endif
         default:
-            printf("Unsupported cart type, exiting...\n");
+#if GB_MBC == GB_MBC_ANY
+            print_fmt("Unsupported cart type, exiting...\n");
+#else
+            print_fmt("Unsupported cart type for this binary, use gbdump.bin, exiting...\n");
+#endif
             goto err_close_exit;
     }
+#endif
 
     /* Set the serial driver to RAW (to avoid \n to \r\n conversion) */
     err = ioctl(uart_dev, SERIAL_CMD_GET_ATTR, (void*) &uart_attr);
     if (err != ERR_SUCCESS) {
-        printf("Get attr error %d\n", err);
+        print_fmt("Get attr error %d\n", err);
         goto err_close_exit;
     }
 
-    wait_for_host(bank_num, bank_size);
+    /* The host can pause or abort a dump if the driver can poll the UART without blocking */
+    uart_poll_supported = ioctl(uart_dev, SERIAL_CMD_GET_TIMEOUT, (void*) &uart_timeout) == ERR_SUCCESS;
+
+    print_fmt("Ready to send, start the dump script on the host computer\n");
 
     if ((uart_attr & SERIAL_ATTR_MODE_RAW) == 0) {
         err = ioctl(uart_dev, SERIAL_CMD_SET_ATTR, (void*) (uart_attr | SERIAL_ATTR_MODE_RAW));
         if (err != ERR_SUCCESS) {
-            printf("Set attr error %d\n", err);
+            print_fmt("Set attr error %d\n", err);
             goto err_close_exit;
         }
     }
 
-    /* Enable the RAM: the first 8KB of the cartridge can be used to enable the cartridge RAM by writing 0xA to it */
-    cart_virt[0] = 0xA;
-
-    /* Enable RAM banking from "Banking Mode Select" register.
-     * This register can be written to when writing cartridge's address 6000–7FFF. Let's map this area to the virtual page.
-     *
-     * NOTE: We can only map physical pages multiple of 16KB! The solution is to map 0x4000 and write at address 0x2000.
-     */
-    if (cart_type == MBC1_RAM_BATT) {
-        /* MBC1 Only */
-        map_cart_phys(0x4000);
-        /* We need to write 1 to it to enable RAM banking (0 disables banking) */
-        cart_virt[0x2000] = 1;
-    }
-
-    /* Finally, let's use our own function to map the cartridge RAM. Let's hardcode the number of banks for the moment */
-    for (uint8_t bank = 0; bank < bank_num; bank++) {
-        /* In the case where #SER0 is the same driver as the STDOUT, we shall not write anything to STDOUT while backup is on-going */
-#if !STDOUT_IS_SERIAL
-        printf("Backing up bank %d...\n", bank);
+    /* Without CMD_RESIDENT, exit after the first dump */
+    uint8_t resident = 0;
+    while (1) {
+        const uint8_t cmd = wait_for_command();
+        TRACE(TRACE_CMD, cmd, 0);
+        switch (cmd) {
+            case CMD_DUMP:
+                send_info(REPLY_INFO, bank_num, bank_size);
+                cart_enable();
+                err = send_banks();
+                /* Leave the cartridge RAM disabled, dump over or aborted, until the next command */
+                cart_disable();
+                if (err != ERR_SUCCESS) {
+                    TRACE(TRACE_ERROR, err, 0);
+                    trace_send();
+                    print_fmt("Error %d, exiting\n", err);
+                    goto err_set_attr;
+                }
+                trace_send();
+                if (!resident) {
+                    goto err_set_attr;
+                }
+                break;
+            case CMD_ROM:
+#if GB_ROM_DUMP
+                if (rom_banks != 0) {
+                    send_info(REPLY_INFO16, rom_banks, GB_ROM_BANK_SIZE);
+                    err = send_rom();
+                    if (err != ERR_SUCCESS) {
+                        TRACE(TRACE_ERROR, err, 0);
+                        trace_send();
+                        print_fmt("Error %d, exiting\n", err);
+                        goto err_set_attr;
+                    }
+                    trace_send();
+                    if (!resident) {
+                        goto err_set_attr;
+                    }
+                    break;
+                }
 #endif
-        map_cart_sram(bank);
-        /* The SRAM 8KB bank is now mapped at GB_CART_VIRT_ADDR still, so we can access it with `cart_virt` array,
-         * send the content to the UART. */
-        size = bank_size;
-        err = write(uart_dev, cart_virt, &size);
-        if (err != ERR_SUCCESS) {
-            printf("Error %d, exiting\n", err);
-            goto err_set_attr;
+                send_reply(REPLY_ERROR, 0);
+                break;
+            case CMD_SRAM_TEST:
+                if (bank_num == 0 || bank_num > GB_SRAM_BANKS_MAX
+#if GB_MBC == GB_MBC_ANY
+                    || cart_type == MBC7_SENSOR_RUMB_RAM_BATT
+#endif
+                    ) {
+                    send_reply(REPLY_ERROR, 0);
+                    break;
+                }
+                cart_enable();
+                err = test_sram();
+                trace_send();
+                cart_disable();
+                if (err != ERR_SUCCESS) {
+                    print_fmt("Error %d, exiting\n", err);
+                    goto err_set_attr;
+                }
+                if (!resident) {
+                    goto err_set_attr;
+                }
+                break;
+            case CMD_WATCH:
+                /* The watch can only be stopped by polling the UART */
+                if (bank_num == 0 || bank_num > GB_SRAM_BANKS_MAX || !uart_poll_supported) {
+                    send_reply(REPLY_ERROR, 0);
+                    break;
+                }
+                send_info(REPLY_INFO, bank_num, bank_size);
+                cart_enable();
+                err = watch_sram();
+                trace_send();
+                cart_disable();
+                if (err != ERR_SUCCESS) {
+                    print_fmt("Error %d, exiting\n", err);
+                    goto err_set_attr;
+                }
+                if (!resident) {
+                    goto err_set_attr;
+                }
+                break;
+            case CMD_SEARCH:
+                err = search_cart();
+                trace_send();
+                if (err != ERR_SUCCESS) {
+                    print_fmt("Error %d, exiting\n", err);
+                    goto err_set_attr;
+                }
+                if (!resident) {
+                    goto err_set_attr;
+                }
+                break;
+            case CMD_STABILITY:
+            {
+                uint8_t passes = STABILITY_PASSES;
+                err = uart_read_all(uart_dev, &passes, 1);
+                if (err == ERR_SUCCESS) {
+                    cart_enable();
+                    err = scan_stability(passes);
+                    trace_send();
+                    cart_disable();
+                }
+                if (err != ERR_SUCCESS) {
+                    print_fmt("Error %d, exiting\n", err);
+                    goto err_set_attr;
+                }
+                if (!resident) {
+                    goto err_set_attr;
+                }
+                break;
+            }
+            case CMD_RESTORE:
+            case CMD_RESTORE_PACKED:
+            case CMD_RESTORE_DELTA:
+                send_info(REPLY_INFO, bank_num, bank_size);
+                cart_enable();
+                if (cmd == CMD_RESTORE) {
+                    err = receive_banks();
+                } else if (cmd == CMD_RESTORE_PACKED) {
+                    err = receive_packed_banks();
+                } else {
+                    err = receive_delta_blocks();
+                }
+                if (err != ERR_SUCCESS) {
+                    TRACE(TRACE_ERROR, err, 0);
+                }
+                send_reply(err == ERR_SUCCESS ? REPLY_OK : REPLY_ERROR, err);
+                trace_send();
+                cart_disable();
+                if (!resident) {
+                    goto err_set_attr;
+                }
+                break;
+            case CMD_CAMERA:
+#if GB_MBC == GB_MBC_ANY
+                if (cart_type == POCKET_CAMERA) {
+                    cart_enable();
+                    err = send_camera_photos();
+                    trace_send();
+                    cart_disable();
+                    if (err != ERR_SUCCESS) {
+                        print_fmt("Error %d, exiting\n", err);
+                        goto err_set_attr;
+                    }
+                    if (!resident) {
+                        goto err_set_attr;
+                    }
+                    break;
+                }
+#endif
+                send_reply(REPLY_ERROR, 0);
+                break;
+            case CMD_RESIDENT:
+                resident = 1;
+                send_reply(REPLY_OK, cart_type);
+                break;
+            case CMD_TRACE:
+                trace_requested = GB_TRACE;
+                send_reply(GB_TRACE ? REPLY_OK : REPLY_ERROR, 0);
+                break;
+            case CMD_UPLOAD:
+                send_reply(stub_upload(uart_dev) ? REPLY_ERROR : REPLY_OK, 0);
+                break;
+            case CMD_QUIT:
+            default:
+                goto err_set_attr;
         }
     }
 
@@ -250,8 +1326,7 @@ err_close_exit:
     close(uart_dev);
 
     /* Disable the cartridge RAM */
-    map_cart_phys(0);
-    cart_virt[0] = 0;
+    cart_disable();
 
     return 0;
 }
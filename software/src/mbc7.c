@@ -0,0 +1,189 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include "gbcart.h"
+#include "mbc7.h"
+
+/**
+ * EEPROM register bits: chip select, clock, data in (to the EEPROM) and data out (from the EEPROM).
+ * DI is sampled by the EEPROM on the rising edges of CLK, DO changes after them.
+ * The 93LC56 clock can go up to 2MHz, much faster than what the loops below can achieve, so
+ * no delay is needed between the edges.
+ */
+#define EEPROM_CS   0x80
+#define EEPROM_CLK  0x40
+#define EEPROM_DI   0x02
+
+/* Parameters of the assembly routines */
+static uint8_t* s_reg;
+static uint8_t s_eeprom[GB_MBC7_EEPROM_SIZE];
+
+
+uint8_t* mbc7_eeprom_buffer(void)
+{
+    return s_eeprom;
+}
+
+
+/**
+ * @brief Shift out the B most significant bits of D, HL points to the EEPROM register.
+ *        Alters A, B and D.
+ */
+static void eeprom_send(void) __naked
+{
+    __asm
+        ld a, #EEPROM_CS
+        sla d
+        jr nc, 00001$
+        or #EEPROM_DI
+00001$:
+        ld (hl), a
+        or #EEPROM_CLK
+        ld (hl), a
+        djnz _eeprom_send
+        ret
+    __endasm;
+}
+
+
+static void eeprom_read_all(void) __naked
+{
+    __asm
+        ld hl, (_s_reg)
+        ld (hl), #0
+        ld (hl), #EEPROM_CS
+        ; Start bit and READ opcode (1 10), then address 0
+        ld d, #0xc0
+        ld b, #3
+        call _eeprom_send
+        ld b, #8
+        call _eeprom_send
+        ; A dummy 0 was shifted out with the last address bit, then the words follow each
+        ; other as long as the clock runs
+        ld de, #_s_eeprom
+00001$:
+        ld b, #8
+00002$:
+        ld (hl), #EEPROM_CS
+        ld (hl), #(EEPROM_CS | EEPROM_CLK)
+        ld a, (hl)
+        rra
+        rl c
+        djnz 00002$
+        ld a, c
+        ld (de), a
+        inc de
+        ; Stop at the end of the buffer
+        ld a, e
+        cp #<(_s_eeprom + GB_MBC7_EEPROM_SIZE)
+        jr nz, 00001$
+        ld a, d
+        cp #>(_s_eeprom + GB_MBC7_EEPROM_SIZE)
+        jr nz, 00001$
+        ld (hl), #0
+        ret
+    __endasm;
+}
+
+
+uint8_t* mbc7_eeprom_read(uint8_t* reg)
+{
+    s_reg = reg;
+    eeprom_read_all();
+    return s_eeprom;
+}
+
+
+/**
+ * @returns 0 in L and A on success, 1 on timeout. The writes are disabled again in both cases.
+ */
+static uint8_t eeprom_write_all(void) __naked
+{
+    __asm
+        ld hl, (_s_reg)
+        ld (hl), #0
+        ; EWEN: 1 00 11xxxxxx
+        ld (hl), #EEPROM_CS
+        ld d, #0x80
+        ld b, #3
+        call _eeprom_send
+        ld d, #0xc0
+        ld b, #8
+        call _eeprom_send
+        ld (hl), #0
+        ld c, #0
+00001$:
+        ; WRITE: 1 01, the address of the word in C and its two bytes
+        ld (hl), #EEPROM_CS
+        ld d, #0xa0
+        ld b, #3
+        call _eeprom_send
+        ld d, c
+        ld b, #8
+        call _eeprom_send
+        push hl
+        ld hl, #_s_eeprom
+        ld a, c
+        add a, a
+        ld e, a
+        ld d, #0
+        add hl, de
+        ld e, (hl)
+        inc hl
+        ld a, (hl)
+        pop hl
+        push af
+        ld d, e
+        ld b, #8
+        call _eeprom_send
+        pop af
+        ld d, a
+        ld b, #8
+        call _eeprom_send
+        ; Deselecting the chip starts the programming, DO stays low until it is over
+        ld (hl), #0
+        ld (hl), #EEPROM_CS
+        ld de, #0
+00002$:
+        ld a, (hl)
+        rra
+        jr c, 00003$
+        dec de
+        ld a, d
+        or e
+        jr nz, 00002$
+        ; Timeout, the writes must still be disabled before returning
+        ld e, #1
+        jr 00004$
+00003$:
+        ld (hl), #0
+        inc c
+        bit 7, c
+        jr z, 00001$
+        ld e, #0
+00004$:
+        ld (hl), #0
+        ; EWDS: 1 00 00xxxxxx
+        ld (hl), #EEPROM_CS
+        ld d, #0x80
+        ld b, #3
+        call _eeprom_send
+        ld d, #0
+        ld b, #8
+        call _eeprom_send
+        ld (hl), #0
+        ld a, e
+        ld l, a
+        ret
+    __endasm;
+}
+
+
+uint8_t mbc7_eeprom_write(uint8_t* reg)
+{
+    s_reg = reg;
+    return eeprom_write_all();
+}
@@ -0,0 +1,39 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * MBC7 cartridges save in a 93LC56 serial EEPROM, 128 16-bit words, instead of an SRAM. Its lines
+ * are driven through a register of the RAM area, mirrored at 0xAx8x, which is only accessible
+ * when 0x40 is also written to the 0x4000 register. The words are sent most significant byte
+ * first, the content of the EEPROM is kept in that order.
+ */
+#define MBC7_REG_OFFSET     0x80
+#define MBC7_RAM_ENABLE2    0x40
+
+/**
+ * @brief Read the whole EEPROM with a single sequential read
+ *
+ * @param reg Address of the mapped EEPROM register
+ *
+ * @returns the buffer containing the EEPROM content
+ */
+uint8_t* mbc7_eeprom_read(uint8_t* reg);
+
+/**
+ * @brief Buffer containing the content to write with `mbc7_eeprom_write`
+ */
+uint8_t* mbc7_eeprom_buffer(void);
+
+/**
+ * @brief Write the buffer to the EEPROM, word by word. Each word takes a few milliseconds to
+ *        program, the EEPROM is polled until it is ready for the next one.
+ *
+ * @returns 0 on success, 1 if the EEPROM never became ready.
+ */
+uint8_t mbc7_eeprom_write(uint8_t* reg);
@@ -0,0 +1,92 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "zos_errors.h"
+#include "zos_vfs.h"
+#include "overlay.h"
+
+/* Directory containing the overlays, the root of the romdisk (EXTRA_ROMDISK_FILES) */
+#ifndef GB_OVERLAY_DIR
+#define GB_OVERLAY_DIR          "A:/"
+#endif
+
+#define GB_OVERLAY_EXT          ".ovl"
+#define GB_OVERLAY_EXT_LEN      4
+
+
+/**
+ * @brief Check whether the directory entry is an overlay. The name is not NULL-terminated when it is
+ *        FILENAME_LEN_MAX characters long.
+ */
+static uint8_t overlay_name(const zos_dir_entry_t* entry, char* path)
+{
+    uint8_t len = 0;
+
+    while (len < FILENAME_LEN_MAX && entry->d_name[len] != 0) {
+        len++;
+    }
+    if (!D_ISFILE(entry->d_flags) || len <= GB_OVERLAY_EXT_LEN ||
+        memcmp(entry->d_name + len - GB_OVERLAY_EXT_LEN, GB_OVERLAY_EXT, GB_OVERLAY_EXT_LEN) != 0) {
+        return 0;
+    }
+    strcpy(path, GB_OVERLAY_DIR);
+    path += sizeof(GB_OVERLAY_DIR) - 1;
+    memcpy(path, entry->d_name, len);
+    path[len] = 0;
+    return 1;
+}
+
+
+static uint8_t overlay_read(const char* path, uint16_t size)
+{
+    zos_dev_t dev = open(path, O_RDONLY);
+    if (dev < 0) {
+        return 0;
+    }
+    zos_err_t err = read(dev, (void*) GB_OVERLAY_ADDR, &size);
+    close(dev);
+    return err == ERR_SUCCESS;
+}
+
+
+static uint8_t overlay_supports(const gb_driver_t* driver, uint8_t cart_type)
+{
+    if (driver->magic[0] != GB_DRIVER_MAGIC_0 || driver->magic[1] != GB_DRIVER_MAGIC_1 ||
+        driver->version != GB_DRIVER_VERSION) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < GB_DRIVER_MAX_TYPES && driver->types[i] != 0; i++) {
+        if (driver->types[i] == cart_type) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+const gb_driver_t* overlay_load(uint8_t cart_type)
+{
+    const gb_driver_t* driver = (const gb_driver_t*) GB_OVERLAY_ADDR;
+    const gb_driver_t* found = NULL;
+    char path[sizeof(GB_OVERLAY_DIR) + FILENAME_LEN_MAX];
+    zos_dir_entry_t entry;
+
+    zos_dev_t dir = opendir(GB_OVERLAY_DIR);
+    if (dir < 0) {
+        return NULL;
+    }
+    while (found == NULL && readdir(dir, &entry) == ERR_SUCCESS) {
+        if (overlay_name(&entry, path) &&
+            overlay_read(path, sizeof(gb_driver_t)) &&
+            overlay_supports(driver, cart_type) &&
+            overlay_read(path, GB_OVERLAY_SIZE)) {
+            found = driver;
+        }
+    }
+    close(dir);
+    return found;
+}
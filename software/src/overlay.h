@@ -0,0 +1,17 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "driver.h"
+
+/**
+ * @brief Look for a driver overlay supporting the given cartridge type in GB_OVERLAY_DIR and load it.
+ *        Only the header of each overlay is read until the right one is found.
+ *
+ * @returns the driver loaded at GB_OVERLAY_ADDR, NULL if none supports the cartridge.
+ */
+const gb_driver_t* overlay_load(uint8_t cart_type);
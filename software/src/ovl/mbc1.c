@@ -0,0 +1,35 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include "driver.h"
+#include "gbcart.h"
+
+static void probe(const gb_core_t* core, uint8_t cart_type, uint8_t* bank_num, uint16_t* bank_size)
+{
+    (void) cart_type;
+    *bank_size = GB_SRAM_BANK_SIZE;
+    *bank_num = core->ram_size(core->cart_virt[0x149]) >> 3;
+}
+
+static void init(const gb_core_t* core, uint8_t cart_type)
+{
+    (void) cart_type;
+    /* Banking mode select register is at 0x6000, write 1 to it to enable RAM banking */
+    core->map_cart_phys(0x4000);
+    core->cart_virt[0x2000] = 1;
+}
+
+static uint8_t* map_sram(const gb_core_t* core, uint8_t bank)
+{
+    /* 2-bit RAM bank register */
+    return core->map_sram(bank & 0x3);
+}
+
+/* Must be the first (and only) constant of the overlay, see driver.h */
+const gb_driver_t driver = {
+    { GB_DRIVER_MAGIC_0, GB_DRIVER_MAGIC_1 }, GB_DRIVER_VERSION,
+    { MBC1_RAM_BATT },
+    probe, init, map_sram
+};
@@ -0,0 +1,36 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include "driver.h"
+#include "gbcart.h"
+
+static void probe(const gb_core_t* core, uint8_t cart_type, uint8_t* bank_num, uint16_t* bank_size)
+{
+    (void) core;
+    (void) cart_type;
+    *bank_size = GB_MBC2_SRAM_SIZE;
+    *bank_num = 1;
+}
+
+static void init(const gb_core_t* core, uint8_t cart_type)
+{
+    (void) core;
+    (void) cart_type;
+}
+
+static uint8_t* map_sram(const gb_core_t* core, uint8_t bank)
+{
+    /* MBC2 has no RAM bank register, its RAM is always at 0xA000 */
+    (void) bank;
+    core->map_cart_phys(0x8000);
+    return core->cart_virt;
+}
+
+/* Must be the first (and only) constant of the overlay, see driver.h */
+const gb_driver_t driver = {
+    { GB_DRIVER_MAGIC_0, GB_DRIVER_MAGIC_1 }, GB_DRIVER_VERSION,
+    { MBC2_RAM_BATT },
+    probe, init, map_sram
+};
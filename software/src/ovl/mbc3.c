@@ -0,0 +1,33 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include "driver.h"
+#include "gbcart.h"
+
+static void probe(const gb_core_t* core, uint8_t cart_type, uint8_t* bank_num, uint16_t* bank_size)
+{
+    (void) cart_type;
+    *bank_size = GB_SRAM_BANK_SIZE;
+    *bank_num = core->ram_size(core->cart_virt[0x149]) >> 3;
+}
+
+static void init(const gb_core_t* core, uint8_t cart_type)
+{
+    (void) core;
+    (void) cart_type;
+}
+
+static uint8_t* map_sram(const gb_core_t* core, uint8_t bank)
+{
+    /* Values 0x08-0x0C select the RTC registers, MBC30 has 8 RAM banks */
+    return core->map_sram(bank & 0x7);
+}
+
+/* Must be the first (and only) constant of the overlay, see driver.h */
+const gb_driver_t driver = {
+    { GB_DRIVER_MAGIC_0, GB_DRIVER_MAGIC_1 }, GB_DRIVER_VERSION,
+    { ROM_RAM_BATT, MBC3_RAM_BATT },
+    probe, init, map_sram
+};
@@ -0,0 +1,96 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include "zos_vfs.h"
+#include "print.h"
+
+/**
+ * The characters are gathered in a small buffer to limit the number of `write` syscalls
+ */
+#define PRINT_BUFFER_SIZE   32
+
+static char s_buffer[PRINT_BUFFER_SIZE];
+static uint8_t s_length = 0;
+
+
+static void print_flush(void)
+{
+    uint16_t size = s_length;
+    if (size != 0) {
+        write(DEV_STDOUT, s_buffer, &size);
+        s_length = 0;
+    }
+}
+
+
+static void print_char(char c)
+{
+    if (s_length == PRINT_BUFFER_SIZE) {
+        print_flush();
+    }
+    s_buffer[s_length++] = c;
+}
+
+
+static void print_number(uint16_t value, uint8_t base)
+{
+    /* 16-bit values have at most 5 digits in base 10 */
+    char digits[5];
+    uint8_t count = 0;
+
+    do {
+        const uint8_t digit = value % base;
+        digits[count++] = digit < 10 ? '0' + digit : 'a' - 10 + digit;
+        value /= base;
+    } while (value != 0);
+
+    while (count != 0) {
+        print_char(digits[--count]);
+    }
+}
+
+
+void print_fmt(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+
+    for (char c = *fmt; c != 0; c = *++fmt) {
+        if (c != '%') {
+            print_char(c);
+            continue;
+        }
+        c = *++fmt;
+        if (c == 'h') {
+            c = *++fmt;
+        }
+        if (c == 'd') {
+            const int16_t value = va_arg(args, int);
+            if (value < 0) {
+                print_char('-');
+            }
+            print_number(value < 0 ? -(uint16_t) value : (uint16_t) value, 10);
+        } else if (c == 'u') {
+            print_number(va_arg(args, unsigned int), 10);
+        } else if (c == 'x') {
+            print_number(va_arg(args, unsigned int), 16);
+        } else if (c == 'c') {
+            print_char(va_arg(args, int));
+        } else if (c == 's') {
+            for (const char* str = va_arg(args, const char*); *str != 0; str++) {
+                print_char(*str);
+            }
+        } else if (c == 0) {
+            break;
+        } else {
+            print_char(c);
+        }
+    }
+
+    va_end(args);
+    print_flush();
+}
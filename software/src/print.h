@@ -0,0 +1,15 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+/**
+ * @brief Minimal replacement for stdio `printf`, written directly to the standard output.
+ *        Supported conversions: %d, %u, %x (16-bit integers), %c, %s and %%. The `h` length
+ *        modifier is accepted and ignored, flags, width and precision are not supported.
+ *
+ * @param fmt Format string, followed by the values to print.
+ */
+void print_fmt(const char* fmt, ...);
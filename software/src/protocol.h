@@ -0,0 +1,101 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+/**
+ * Serial protocol between the host (dump.py) and the program. The host sends one-byte commands,
+ * possibly followed by parameters. Without CMD_RESIDENT, the program exits after the first dump,
+ * like the original protocol: the host sends '!' and receives '=', the number of banks (8-bit),
+ * the size of a bank (16-bit little-endian), then the content of all the banks.
+ */
+#define CMD_DUMP            '!'
+/* Restore: reply REPLY_INFO like CMD_DUMP, then the host sends the content of each bank after the
+ * program replies REPLY_READY followed by the bank number: the UART can't receive while the program
+ * maps or writes a bank. Reply: REPLY_OK or REPLY_ERROR, followed by the error code */
+#define CMD_RESTORE         'W'
+/* Restore with compression: reply REPLY_INFO like CMD_RESTORE, then the content of each bank is
+ * sent as frames. Before each frame, the program replies REPLY_READY followed by the bank number,
+ * the host then sends the frame header (PACK_HEADER_SIZE bytes): the frame type, the size of the
+ * data that follows and its decoded size (16-bit little-endian). The data is decoded in the bank,
+ * after the previous frames. The last frame of a bank is PACK_END, followed by the hash of the
+ * bank content (32-bit little-endian, see hash.h) instead of the sizes. Reply: same as CMD_RESTORE */
+#define CMD_RESTORE_PACKED  'Z'
+#define PACK_RAW            0
+#define PACK_RLE            1
+#define PACK_LZ             2
+#define PACK_END            0xff
+#define PACK_HEADER_SIZE    5
+/* Delta restore: reply REPLY_INFO like CMD_RESTORE, followed by the hash of each DELTA_BLOCK_SIZE
+ * block of the banks, in order (32-bit little-endian, see hash.h). Then, before each block, the
+ * program replies REPLY_READY followed by 0, the host sends the block header (DELTA_HEADER_SIZE
+ * bytes): the bank number, the block number in the bank and the hash of the new content, followed
+ * by the block content. The block is written and read back to check its hash. With DELTA_READ set
+ * in the bank number, the block is read instead: the program sends it as REPLY_BLOCK (see CMD_WATCH)
+ * and the hash is ignored. A DELTA_END bank number ends the restore, without hash nor content.
+ * Reply: same as CMD_RESTORE */
+#define CMD_RESTORE_DELTA   'D'
+#define DELTA_BLOCK_SIZE    256
+#define DELTA_HEADER_SIZE   6
+#define DELTA_READ          0x80
+#define DELTA_END           0xff
+/* Game Boy Camera only: reply REPLY_OK followed by the slot state vector (GB_CAMERA_SLOTS bytes),
+ * then the content of the occupied slots only, in order. Reply REPLY_ERROR, followed by 0, for the
+ * other cartridges */
+#define CMD_CAMERA          'M'
+/* Dump the ROM instead of the SRAM: reply REPLY_INFO16 with the number of 16KB ROM banks, followed
+ * by their content, like CMD_DUMP. Only MBC1 and MBC5 cartridges are supported, reply REPLY_ERROR,
+ * followed by 0, for the other ones */
+#define CMD_ROM             'O'
+/* Test the SRAM without losing its content, see sramtest.h. Heartbeats are sent during the test,
+ * then REPLY_OK followed by the number of banks and the sram_test_result_t of each bank. Reply
+ * REPLY_ERROR, followed by 0, when the cartridge has no SRAM */
+#define CMD_SRAM_TEST       'X'
+/* Pattern search, followed by the target (SEARCH_ROM or SEARCH_SRAM), the number of patterns, then
+ * each pattern as a fixed-size record: its length, its bytes and the mask of each byte, both padded
+ * to SEARCH_PATTERN_MAX bytes, see search.h. Heartbeats are sent during the search, then REPLY_OK
+ * followed by the number of matches and the search_match_t of each match, SEARCH_MATCHES_MAX at
+ * most. Reply REPLY_ERROR, followed by 0, when a parameter is invalid or the target can't be
+ * searched */
+#define CMD_SEARCH          'S'
+#define SEARCH_ROM          0
+#define SEARCH_SRAM         1
+/* Read-stability scan, followed by the number of passes (8-bit), see stability.h. Heartbeats are
+ * sent during the scan, then REPLY_OK followed by the number of blocks and the stability_block_t
+ * of each block */
+#define CMD_STABILITY       'V'
+/* Watch the SRAM: reply REPLY_INFO like CMD_DUMP, then the SRAM is hashed again and again by blocks
+ * of DELTA_BLOCK_SIZE bytes, each block whose hash changed since the previous pass is sent as
+ * REPLY_BLOCK, followed by the bank number, the block number in the bank and the block content.
+ * All the blocks are sent on the first pass. Heartbeats, giving the pass number, are sent between
+ * the passes. The watch stops on CMD_ABORT, polled between two passes. Reply: REPLY_OK followed by
+ * 0, REPLY_ERROR followed by 0 when the serial driver can't be polled */
+#define CMD_WATCH           'L'
+/* Stay resident: after a dump, wait for the next command instead of exiting.
+ * Reply: REPLY_OK followed by the cartridge type, so that the host can pick a stub for it */
+#define CMD_RESIDENT        'R'
+/* Upload a code stub, see stub.h. Reply: REPLY_OK or REPLY_ERROR, followed by 0 */
+#define CMD_UPLOAD          'U'
+/* Send the event trace at the end of each dump, see trace.h. Reply: REPLY_OK or REPLY_ERROR if the
+ * trace is not compiled in, followed by 0 */
+#define CMD_TRACE           'T'
+/* Sent by the host during a dump, polled between two banks: abort the dump, it is followed by the
+ * trace if requested. Pause it until CMD_RESUME or CMD_ABORT is received. */
+#define CMD_ABORT           'A'
+#define CMD_PAUSE           'P'
+#define CMD_RESUME          'C'
+/* Exit the resident mode */
+#define CMD_QUIT            'Q'
+
+#define REPLY_INFO          '='
+/* Same as REPLY_INFO with a 16-bit number of banks, for the ROM of the largest cartridges (512 banks) */
+#define REPLY_INFO16        '+'
+#define REPLY_OK            'K'
+#define REPLY_ERROR         'E'
+#define REPLY_TRACE         '~'
+#define REPLY_READY         '>'
+#define REPLY_BLOCK         '#'
+/* Sent during long operations, before their reply, see heartbeat.h */
+#define REPLY_HEARTBEAT     'H'
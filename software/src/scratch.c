@@ -0,0 +1,15 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include "scratch.h"
+
+static uint8_t s_scratch[SCRATCH_SIZE];
+
+
+uint8_t* scratch_buffer(void)
+{
+    return s_scratch;
+}
@@ -0,0 +1,20 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Scratch area shared by the operations that need a large buffer and never run at the same time:
+ * the SRAM test backup, the frames of the compressed restore, the hashes of the SRAM watch and the
+ * search patterns. Its content doesn't survive from one command to the next one.
+ */
+#define SCRATCH_SIZE        (2*1024)
+
+/**
+ * @brief Get the scratch area, SCRATCH_SIZE bytes big
+ */
+uint8_t* scratch_buffer(void);
@@ -0,0 +1,110 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include "search.h"
+
+/* Parameters of the assembly routine, the pointer and the count are updated when it stops */
+static const uint8_t* s_ptr;
+static uint16_t s_len;
+static uint8_t s_value;
+
+
+/**
+ * @brief Look for s_value in the s_len bytes at s_ptr, s_len can't be 0. About 21 T-states per byte.
+ *
+ * @returns 1 in L and A when the byte is found, s_ptr is then the address following it and s_len
+ *          the number of bytes left after it. 0 when it is not found.
+ */
+static uint8_t find_byte(void) __naked
+{
+    __asm
+        ld hl, (_s_ptr)
+        ld bc, (_s_len)
+        ld a, (_s_value)
+        cpir
+        jr nz, 00001$
+        ld (_s_ptr), hl
+        ld (_s_len), bc
+        ld a, #1
+        ld l, a
+        ret
+00001$:
+        xor a
+        ld l, a
+        ret
+    __endasm;
+}
+
+
+static uint8_t pattern_matches(const uint8_t* data, const search_pattern_t* pattern)
+{
+    for (uint8_t i = 0; i < pattern->len; i++) {
+        if ((data[i] & pattern->mask[i]) != pattern->bytes[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/**
+ * @returns 1 when the result is full
+ */
+static uint8_t add_match(search_result_t* result, uint8_t index, uint16_t bank, uint16_t offset)
+{
+    search_match_t* match = &result->matches[result->count++];
+    match->pattern = index;
+    match->bank = bank;
+    match->offset = offset;
+    return result->count == SEARCH_MATCHES_MAX;
+}
+
+
+void search_prepare(search_pattern_t* pattern)
+{
+    pattern->anchor = pattern->len;
+    for (uint8_t i = 0; i < pattern->len; i++) {
+        pattern->bytes[i] &= pattern->mask[i];
+        if (pattern->mask[i] == 0xff && pattern->anchor == pattern->len) {
+            pattern->anchor = i;
+        }
+    }
+}
+
+
+void search_block(const uint8_t* data, uint16_t len, uint16_t bank,
+                  const search_pattern_t* patterns, uint8_t count, search_result_t* result)
+{
+    if (result->count == SEARCH_MATCHES_MAX) {
+        return;
+    }
+    for (uint8_t index = 0; index < count; index++) {
+        const search_pattern_t* pattern = &patterns[index];
+        if (len < pattern->len) {
+            continue;
+        }
+        const uint16_t positions = len - pattern->len + 1;
+        if (pattern->anchor == pattern->len) {
+            /* No byte to look for, compare the pattern at each position */
+            for (uint16_t offset = 0; offset < positions; offset++) {
+                if (pattern_matches(data + offset, pattern) && add_match(result, index, bank, offset)) {
+                    return;
+                }
+            }
+            continue;
+        }
+        s_ptr = data + pattern->anchor;
+        s_len = positions;
+        s_value = pattern->bytes[pattern->anchor];
+        while (s_len != 0 && find_byte()) {
+            const uint8_t* start = s_ptr - 1 - pattern->anchor;
+            if (pattern_matches(start, pattern) &&
+                add_match(result, index, bank, (uint16_t) (start - data))) {
+                return;
+            }
+        }
+    }
+}
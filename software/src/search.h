@@ -0,0 +1,59 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Pattern search in the cartridge memory: each pattern is a sequence of bytes with a mask per byte,
+ * only the bits set in the mask are compared. The candidates are found with CPIR on the first byte
+ * of the pattern whose mask is 0xFF, the rest of the pattern is then compared. The search is done
+ * in a mapped bank, a pattern spanning two banks is not found.
+ */
+#define SEARCH_PATTERNS_MAX     8
+#define SEARCH_PATTERN_MAX      16
+#define SEARCH_MATCHES_MAX      64
+
+typedef struct {
+    uint8_t len;
+    /* Index of the first byte with a 0xFF mask, filled by search_prepare */
+    uint8_t anchor;
+    uint8_t bytes[SEARCH_PATTERN_MAX];
+    uint8_t mask[SEARCH_PATTERN_MAX];
+} search_pattern_t;
+
+/**
+ * Match sent as is to the host (little-endian, 5 bytes)
+ */
+typedef struct {
+    /* Index of the pattern */
+    uint8_t  pattern;
+    /* ROM or SRAM bank */
+    uint16_t bank;
+    /* Offset of the match in the bank */
+    uint16_t offset;
+} search_match_t;
+
+typedef struct {
+    uint8_t        count;
+    search_match_t matches[SEARCH_MATCHES_MAX];
+} search_result_t;
+
+/**
+ * @brief Prepare a pattern received from the host for the search, its length must be between 1
+ *        and SEARCH_PATTERN_MAX. The result must be cleared (count set to 0) before the first search.
+ */
+void search_prepare(search_pattern_t* pattern);
+
+/**
+ * @brief Search the patterns in a mapped block and add the matches to the result, until it is full.
+ *
+ * @param data Mapped block
+ * @param len Size of the block
+ * @param bank Bank of the block, reported in the matches, the offsets are relative to `data`
+ */
+void search_block(const uint8_t* data, uint16_t len, uint16_t bank,
+                  const search_pattern_t* patterns, uint8_t count, search_result_t* result);
@@ -0,0 +1,184 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "sramtest.h"
+#include "scratch.h"
+
+_Static_assert(SRAM_TEST_BLOCK_SIZE <= SCRATCH_SIZE, "The SRAM test backup must fit in the scratch area");
+
+/* Parameters of the assembly routines, the pointer and the count are updated when they stop */
+static uint8_t* s_ptr;
+static uint16_t s_len;
+static uint8_t s_expect;
+static uint8_t s_value;
+static uint8_t s_mask;
+
+
+/**
+ * @brief March element, in ascending order: read each byte, compare it to s_expect on the bits
+ *        of s_mask, then write s_value to it. Stops on the first byte different from s_expect, before
+ *        writing it.
+ *
+ * @returns 0 in L and A when all the bytes were processed, 1 on a mismatch, s_ptr and s_len are
+ *          then the address of the byte and the number of bytes left, including it.
+ */
+static uint8_t march_up(void) __naked
+{
+    __asm
+        push ix
+        ld a, (_s_mask)
+        ld ixl, a
+        ld hl, (_s_ptr)
+        ld bc, (_s_len)
+        ld a, (_s_expect)
+        ld d, a
+        ld a, (_s_value)
+        ld e, a
+00001$:
+        ld a, (hl)
+        xor d
+        and ixl
+        jr nz, 00002$
+        ld (hl), e
+        inc hl
+        dec bc
+        ld a, b
+        or c
+        jr nz, 00001$
+        pop ix
+        ld l, a
+        ret
+00002$:
+        ld (_s_ptr), hl
+        ld (_s_len), bc
+        pop ix
+        ld a, #1
+        ld l, a
+        ret
+    __endasm;
+}
+
+
+/**
+ * @brief Same as `march_up`, in descending order, s_ptr points to the last byte
+ */
+static uint8_t march_down(void) __naked
+{
+    __asm
+        push ix
+        ld a, (_s_mask)
+        ld ixl, a
+        ld hl, (_s_ptr)
+        ld bc, (_s_len)
+        ld a, (_s_expect)
+        ld d, a
+        ld a, (_s_value)
+        ld e, a
+00001$:
+        ld a, (hl)
+        xor d
+        and ixl
+        jr nz, 00002$
+        ld (hl), e
+        dec hl
+        dec bc
+        ld a, b
+        or c
+        jr nz, 00001$
+        pop ix
+        ld l, a
+        ret
+00002$:
+        ld (_s_ptr), hl
+        ld (_s_len), bc
+        pop ix
+        ld a, #1
+        ld l, a
+        ret
+    __endasm;
+}
+
+
+static void record_error(sram_test_result_t* result, uint8_t diff, uint8_t expect, uint16_t offset)
+{
+    if (result->errors == 0) {
+        result->first = offset;
+    }
+    if (result->errors != 0xffff) {
+        result->errors++;
+    }
+    result->stuck0 |= diff & expect;
+    result->stuck1 |= diff & ~expect;
+}
+
+
+/**
+ * @brief Run a march element on the block: read `expect` and write `value` to each byte. The bits
+ *        outside of the mask are not compared.
+ */
+static void march_element(uint8_t* block, uint16_t size, uint8_t expect, uint8_t value, uint8_t down,
+                          uint8_t mask, uint16_t offset, sram_test_result_t* result)
+{
+    s_ptr = down ? block + size - 1 : block;
+    s_len = size;
+    s_expect = expect;
+    s_value = value;
+    s_mask = mask;
+    while (down ? march_down() : march_up()) {
+        const uint8_t diff = (*s_ptr ^ expect) & mask;
+        if (diff) {
+            record_error(result, diff, expect, offset + (uint16_t) (s_ptr - block));
+        }
+        *s_ptr = value;
+        s_ptr += down ? -1 : 1;
+        if (--s_len == 0) {
+            break;
+        }
+    }
+}
+
+
+void sram_test_reset(sram_test_result_t* result)
+{
+    result->errors = 0;
+    result->first = 0xffff;
+    result->stuck0 = 0;
+    result->stuck1 = 0;
+}
+
+
+void sram_test_block(uint8_t* block, uint16_t size, uint8_t mask, uint16_t offset,
+                     sram_test_result_t* result)
+{
+    /* The block is backed up in the scratch area */
+    uint8_t* const backup = scratch_buffer();
+    memcpy(backup, block, size);
+
+    /* March C-: (w0) up(r0,w1) up(r1,w0) down(r0,w1) down(r1,w0) (r0) */
+    for (uint8_t background = 0x00; ; background = 0x55) {
+        const uint8_t inverse = ~background;
+        memset(block, background, size);
+        march_element(block, size, background, inverse, 0, mask, offset, result);
+        march_element(block, size, inverse, background, 0, mask, offset, result);
+        march_element(block, size, background, inverse, 1, mask, offset, result);
+        march_element(block, size, inverse, background, 1, mask, offset, result);
+        march_element(block, size, background, background, 0, mask, offset, result);
+        if (background == 0x55) {
+            break;
+        }
+    }
+
+    memcpy(block, backup, size);
+    if (memcmp(block, backup, size) != 0) {
+        for (uint16_t i = 0; i < size; i++) {
+            const uint8_t diff = (block[i] ^ backup[i]) & mask;
+            if (diff) {
+                record_error(result, diff, backup[i], offset + i);
+            }
+        }
+    }
+}
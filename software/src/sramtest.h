@@ -0,0 +1,46 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Non-destructive SRAM test: each block is backed up in the program memory, tested with the March C-
+ * algorithm, once with the 0x00/0xFF backgrounds and once with 0x55/0xAA for the coupling between
+ * the bits of a byte, then restored. The blocks are at most SRAM_TEST_BLOCK_SIZE big, only this
+ * amount of the save is held outside of the cartridge at a time.
+ */
+#define SRAM_TEST_BLOCK_SIZE    (2*1024)
+
+/**
+ * Result of the test of an SRAM bank, sent as is to the host (little-endian, 6 bytes)
+ */
+typedef struct {
+    /* Number of failed reads, saturated to 0xFFFF */
+    uint16_t errors;
+    /* Offset, in the bank, of the first failed read. 0xFFFF when there is none */
+    uint16_t first;
+    /* Bits read as 0 instead of 1, and as 1 instead of 0 */
+    uint8_t  stuck0;
+    uint8_t  stuck1;
+} sram_test_result_t;
+
+/**
+ * @brief Clear the result before testing a bank
+ */
+void sram_test_reset(sram_test_result_t* result);
+
+/**
+ * @brief Test a block of SRAM and restore its content. The restored content is checked too, its
+ *        errors are counted in the result like the errors of the test.
+ *
+ * @param block Mapped SRAM block, SRAM_TEST_BLOCK_SIZE bytes at most
+ * @param size Size of the block
+ * @param mask Bits implemented by the SRAM, 0x0F for the MBC2 4-bit RAM
+ * @param offset Offset of the block in its bank, to report the first error
+ */
+void sram_test_block(uint8_t* block, uint16_t size, uint8_t mask, uint16_t offset,
+                     sram_test_result_t* result);
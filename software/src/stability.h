@@ -0,0 +1,34 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Read-stability scan: a sample of blocks of the ROM and of the SRAM is read several times and the
+ * hash of each read (see hash.h) is compared to the one of the first pass. A dirty or badly seated cartridge
+ * gives unstable reads long before a whole dump would show it.
+ */
+#define STABILITY_BLOCK_SIZE    256
+#define STABILITY_BLOCKS_MAX    12
+#define STABILITY_PASSES        50
+
+#define STABILITY_ROM           0
+#define STABILITY_SRAM          1
+
+/**
+ * Block of the sample and its result, sent as is to the host (little-endian, 5 bytes)
+ */
+typedef struct {
+    /* STABILITY_ROM or STABILITY_SRAM */
+    uint8_t  kind;
+    /* SRAM bank, 0 for the ROM */
+    uint8_t  bank;
+    /* Cartridge address of the ROM block, offset in the bank of the SRAM block */
+    uint16_t offset;
+    /* Number of passes whose hash differs from the first one */
+    uint8_t  unstable;
+} stability_block_t;
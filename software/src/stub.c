@@ -0,0 +1,80 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "uart.h"
+#include "stub.h"
+
+static uint8_t s_stub[GB_STUB_SIZE];
+static uint8_t s_loaded = 0;
+
+
+uint8_t stub_upload(zos_dev_t dev)
+{
+    uint16_t header[2];
+    uint16_t offset;
+    uint8_t sum = 0;
+    uint8_t expected;
+    uint8_t valid = 1;
+
+    s_loaded = 0;
+    if (uart_read_all(dev, header, sizeof(header)) != ERR_SUCCESS) {
+        return 1;
+    }
+    const uint16_t size = header[0];
+    uint16_t relocs = header[1];
+    if (size < sizeof(gb_stub_t) || size > GB_STUB_SIZE) {
+        /* Read the code, the relocations and the checksum anyway, so that none of them is taken
+         * as a command. Nothing is loaded, the stub buffer can receive them. */
+        uint32_t left = size + 2 * (uint32_t) relocs + 1;
+        while (left != 0) {
+            const uint16_t chunk = left < GB_STUB_SIZE ? (uint16_t) left : GB_STUB_SIZE;
+            if (uart_read_all(dev, s_stub, chunk) != ERR_SUCCESS) {
+                break;
+            }
+            left -= chunk;
+        }
+        return 1;
+    }
+
+    if (uart_read_all(dev, s_stub, size) != ERR_SUCCESS) {
+        return 1;
+    }
+    for (uint16_t i = 0; i < size; i++) {
+        sum += s_stub[i];
+    }
+
+    while (relocs-- != 0) {
+        if (uart_read_all(dev, &offset, sizeof(offset)) != ERR_SUCCESS) {
+            return 1;
+        }
+        sum += (offset & 0xff) + (offset >> 8);
+        /* Keep receiving the relocations even if one is invalid */
+        if (offset >= size - 1) {
+            valid = 0;
+            continue;
+        }
+        *((uint16_t*) (s_stub + offset)) += (uint16_t) s_stub;
+    }
+
+    if (uart_read_all(dev, &expected, 1) != ERR_SUCCESS || expected != sum || !valid) {
+        return 1;
+    }
+    s_loaded = 1;
+    return 0;
+}
+
+
+gb_stub_t* stub_get(void)
+{
+    return s_loaded ? (gb_stub_t*) s_stub : NULL;
+}
+
+
+void stub_run(void)
+{
+    ((void (*)(void)) s_stub)();
+}
@@ -0,0 +1,52 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "zos_vfs.h"
+
+/**
+ * Code stubs uploaded by the host with CMD_UPLOAD, for example a checksum or a compressor, called for
+ * each bank before it is sent. Format on the link, all 16-bit values are little-endian:
+ *   - size of the code (16-bit), at most GB_STUB_SIZE
+ *   - number of relocations (16-bit)
+ *   - code, starting with a gb_stub_t header
+ *   - relocations: offset in the code of each 16-bit absolute address, the load address of the
+ *     code is added to them
+ *   - 8-bit sum of the code and the relocation bytes
+ *
+ * The stub is called with the parameters set in its header and can modify them, for example to
+ * send its own buffer instead of the bank. It must preserve IX and IY. When a stub is loaded,
+ * each bank is sent preceded by the size (16-bit) given back by the stub.
+ * gbstub.py, at the root of the repository, builds the stubs.
+ */
+#define GB_STUB_SIZE        1024
+
+typedef struct {
+    /* `jp` to the entry point of the stub */
+    uint8_t  jump[3];
+    /* Parameters: bank content, its size and its number */
+    uint8_t* data;
+    uint16_t size;
+    uint8_t  bank;
+} gb_stub_t;
+
+/**
+ * @brief Receive a stub from the host (the CMD_UPLOAD parameters) and relocate it.
+ *
+ * @returns 0 on success, 1 if the stub is invalid or if it could not be received.
+ */
+uint8_t stub_upload(zos_dev_t dev);
+
+/**
+ * @brief Return the header of the loaded stub, NULL if there is none.
+ */
+gb_stub_t* stub_get(void);
+
+/**
+ * @brief Call the loaded stub with the parameters of its header.
+ */
+void stub_run(void);
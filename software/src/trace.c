@@ -0,0 +1,54 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include "zos_time.h"
+#include "protocol.h"
+#include "uart.h"
+#include "trace.h"
+
+#if GB_TRACE
+
+static trace_event_t s_events[TRACE_EVENTS];
+/* Index of the next event to write and number of valid events */
+static uint8_t s_head = 0;
+static uint8_t s_count = 0;
+
+
+void trace_event(uint8_t type, uint8_t arg8, uint16_t arg16)
+{
+    zos_time_t now = { 0 };
+    trace_event_t* event = &s_events[s_head];
+
+    /* Without a clock, the events are kept with a null timestamp */
+    gettime(0, &now);
+    event->type = type;
+    event->arg8 = arg8;
+    event->time = now.t_millis;
+    event->arg16 = arg16;
+    s_head = (s_head + 1) & (TRACE_EVENTS - 1);
+    if (s_count < TRACE_EVENTS) {
+        s_count++;
+    }
+}
+
+
+void trace_flush(zos_dev_t dev)
+{
+    uint8_t header[2] = { REPLY_TRACE, s_count };
+    const uint8_t first = (s_head - s_count) & (TRACE_EVENTS - 1);
+
+    uart_write_all(dev, header, sizeof(header));
+    /* The oldest events are at the end of the buffer when it wrapped around */
+    if (first + s_count > TRACE_EVENTS) {
+        uart_write_all(dev, &s_events[first], (TRACE_EVENTS - first) * sizeof(trace_event_t));
+        uart_write_all(dev, s_events, s_head * sizeof(trace_event_t));
+    } else {
+        uart_write_all(dev, &s_events[first], s_count * sizeof(trace_event_t));
+    }
+    s_count = 0;
+}
+
+#endif
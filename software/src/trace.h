@@ -0,0 +1,62 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "zos_vfs.h"
+
+/**
+ * Event trace kept in a ring buffer of the program page, for post-mortem analysis of slow or failed
+ * dumps. When the host asks for it (CMD_TRACE), the trace is sent at the end of each dump, on success
+ * or error: REPLY_TRACE, the number of events (8-bit), then the events, oldest first.
+ * Compiled out when GB_TRACE is 0 (`make TRACE=0`).
+ */
+#ifndef GB_TRACE
+#define GB_TRACE            1
+#endif
+
+/* Number of events kept, must be a power of two */
+#define TRACE_EVENTS        64
+
+typedef enum {
+    /* Physical address mapped: arg8 is bits 16-23, arg16 bits 0-15 */
+    TRACE_MAP = 1,
+    /* SRAM bank selected: arg8 is the bank */
+    TRACE_BANK,
+    /* Write to the UART: arg8 is the error, arg16 the size */
+    TRACE_UART_WRITE,
+    /* Error: arg8 is the error code */
+    TRACE_ERROR,
+    /* Command received from the host: arg8 is the command */
+    TRACE_CMD,
+    /* Read from the UART: arg8 is the error, arg16 the size */
+    TRACE_UART_READ,
+} trace_type_t;
+
+/* All the fields are little-endian on the link, time is in milliseconds and wraps around */
+typedef struct {
+    uint8_t  type;
+    uint8_t  arg8;
+    uint16_t time;
+    uint16_t arg16;
+} trace_event_t;
+
+#if GB_TRACE
+
+#define TRACE(type, arg8, arg16)    trace_event((type), (arg8), (arg16))
+
+void trace_event(uint8_t type, uint8_t arg8, uint16_t arg16);
+
+/**
+ * @brief Send the events to the given device and empty the ring buffer
+ */
+void trace_flush(zos_dev_t dev);
+
+#else
+
+#define TRACE(type, arg8, arg16)
+
+#endif
@@ -0,0 +1,41 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include "uart.h"
+
+
+zos_err_t uart_read_all(zos_dev_t dev, void* buffer, uint16_t len)
+{
+    uint8_t* dst = (uint8_t*) buffer;
+
+    while (len != 0) {
+        uint16_t size = len;
+        zos_err_t err = read(dev, dst, &size);
+        if (err != ERR_SUCCESS) {
+            return err;
+        }
+        dst += size;
+        len -= size;
+    }
+    return ERR_SUCCESS;
+}
+
+
+zos_err_t uart_write_all(zos_dev_t dev, const void* buffer, uint16_t len)
+{
+    const uint8_t* src = (const uint8_t*) buffer;
+
+    while (len != 0) {
+        uint16_t size = len;
+        zos_err_t err = write(dev, src, &size);
+        if (err != ERR_SUCCESS) {
+            return err;
+        }
+        src += size;
+        len -= size;
+    }
+    return ERR_SUCCESS;
+}
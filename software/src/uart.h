@@ -0,0 +1,20 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "zos_errors.h"
+#include "zos_vfs.h"
+
+/**
+ * @brief Read exactly `len` bytes from the given device, the driver may return less bytes per call.
+ */
+zos_err_t uart_read_all(zos_dev_t dev, void* buffer, uint16_t len);
+
+/**
+ * @brief Write the given bytes to the device
+ */
+zos_err_t uart_write_all(zos_dev_t dev, const void* buffer, uint16_t len);
@@ -0,0 +1,191 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#include <stdint.h>
+#include "unpack.h"
+
+/* Parameters of the assembly routines, s_out is updated when they return, NULL if the output
+ * would have gone past s_out_end */
+static const uint8_t* s_in;
+static const uint8_t* s_in_end;
+static uint8_t* s_out;
+static uint8_t* s_out_end;
+
+
+/**
+ * @brief Check whether HL reached s_in_end. Alters A.
+ *
+ * @returns NC when HL >= s_in_end
+ */
+static void unpack_at_end(void) __naked
+{
+    __asm
+        push de
+        ld de, (_s_in_end)
+        ld a, l
+        sub e
+        ld a, h
+        sbc a, d
+        pop de
+        ret
+    __endasm;
+}
+
+
+/**
+ * @brief Check whether BC bytes can be written at DE, DE must not be past s_out_end
+ *
+ * @returns C when they don't fit
+ */
+static void unpack_fits(void) __naked
+{
+    __asm
+        push hl
+        ld hl, (_s_out_end)
+        or a
+        sbc hl, de
+        sbc hl, bc
+        pop hl
+        ret
+    __endasm;
+}
+
+
+static void unpack_rle_run(void) __naked
+{
+    __asm
+        ld hl, (_s_in)
+        ld de, (_s_out)
+00001$:
+        call _unpack_at_end
+        jr nc, 00009$
+        ld a, (hl)
+        inc hl
+        cp #0x80
+        jr nc, 00002$
+        ; 0x00-0x7F: n+1 literal bytes
+        ld c, a
+        ld b, #0
+        inc bc
+        call _unpack_fits
+        jr c, 00008$
+        ldir
+        jr 00001$
+00002$:
+        ; 0x80-0xFF: the next byte repeated n - 0x80 + 2 times
+        sub #0x7e
+        ld c, a
+        ld b, #0
+        call _unpack_fits
+        jr c, 00008$
+        ld b, c
+        ld a, (hl)
+        inc hl
+00003$:
+        ld (de), a
+        inc de
+        djnz 00003$
+        jr 00001$
+00008$:
+        ld de, #0
+00009$:
+        ld (_s_out), de
+        ret
+    __endasm;
+}
+
+
+static void unpack_lz_run(void) __naked
+{
+    __asm
+        ld hl, (_s_in)
+        ld de, (_s_out)
+00001$:
+        ; Flag byte of the next 8 items, LSB first, 1 for a match
+        call _unpack_at_end
+        jr nc, 00009$
+        ld c, (hl)
+        inc hl
+        ld b, #8
+00002$:
+        call _unpack_at_end
+        jr nc, 00009$
+        srl c
+        jr c, 00003$
+        ; Literal, DE can't be past s_out_end: it fits unless DE is s_out_end
+        ld a, (_s_out_end)
+        cp e
+        jr nz, 00004$
+        ld a, (_s_out_end + 1)
+        cp d
+        jr z, 00008$
+00004$:
+        ld a, (hl)
+        ld (de), a
+        inc hl
+        inc de
+        djnz 00002$
+        jr 00001$
+00003$:
+        ; Match: offset low byte, then offset high nibble and length - 3
+        push bc
+        ld c, (hl)
+        inc hl
+        ld a, (hl)
+        inc hl
+        ld b, a
+        srl b
+        srl b
+        srl b
+        srl b
+        and #0x0f
+        add a, #3
+        ; Copy from DE - offset, byte per byte: the source can overlap the destination
+        push hl
+        ld h, d
+        ld l, e
+        or a
+        sbc hl, bc
+        ld c, a
+        ld b, #0
+        call _unpack_fits
+        jr c, 00007$
+        ldir
+        pop hl
+        pop bc
+        djnz 00002$
+        jr 00001$
+00007$:
+        pop hl
+        pop bc
+00008$:
+        ld de, #0
+00009$:
+        ld (_s_out), de
+        ret
+    __endasm;
+}
+
+
+uint8_t* unpack_rle(const uint8_t* in, uint16_t len, uint8_t* out, uint8_t* out_end)
+{
+    s_in = in;
+    s_in_end = in + len;
+    s_out = out;
+    s_out_end = out_end;
+    unpack_rle_run();
+    return s_out;
+}
+
+
+uint8_t* unpack_lz(const uint8_t* in, uint16_t len, uint8_t* out, uint8_t* out_end)
+{
+    s_in = in;
+    s_in_end = in + len;
+    s_out = out;
+    s_out_end = out_end;
+    unpack_lz_run();
+    return s_out;
+}
@@ -0,0 +1,37 @@
+/* SPDX-FileCopyrightText: 2023 Zeal 8-bit Computer <contact@zeal8bit.com>
+ *
+ * SPDX-License-Identifier: CC0-1.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Maximum size of an encoded frame, it must match PACK_FRAME_MAX in gbcodec.py
+ */
+#define UNPACK_FRAME_SIZE   1024
+
+/**
+ * Decoders of the encodings of gbcodec.py, used to restore compressed saves. The output is written
+ * straight to its destination, the mapped SRAM bank: the LZ matches are copied from the bytes
+ * already written there, so a frame can refer to the previous frames of the same bank.
+ */
+
+/**
+ * @brief Decode RLE (PackBits-like) packets
+ *
+ * @param in Encoded data, only made of complete packets
+ * @param len Size of the encoded data, can't be 0
+ * @param out Destination of the decoded data
+ * @param out_end End of the destination, nothing is written from this address
+ *
+ * @returns the address following the last byte written, NULL if the data decodes to more bytes
+ *          than the destination can hold
+ */
+uint8_t* unpack_rle(const uint8_t* in, uint16_t len, uint8_t* out, uint8_t* out_end);
+
+/**
+ * @brief Decode LZSS groups, the last group can be incomplete. Same parameters as `unpack_rle`.
+ */
+uint8_t* unpack_lz(const uint8_t* in, uint16_t len, uint8_t* out, uint8_t* out_end);